@@ -0,0 +1,38 @@
+// Replacements of the global operator new and delete, so AllocStats can count every C++
+// heap allocation (--alloc-stats). They live in their own file so the compiler never
+// inlines them into the game's code, where it would pair malloc and free with new and
+// delete and warn about a mismatch.
+#include <cstdlib>
+#include <new>
+#include "AllocStats.h"
+
+using namespace std;
+
+void *operator new(size_t size)
+{
+    AllocStats::count(size);
+    void *memory = malloc(size ? size : 1);
+    if (!memory)
+        throw bad_alloc();
+    return memory;
+}
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+void operator delete[](void *memory) noexcept
+{
+    free(memory);
+}
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
+void operator delete[](void *memory, size_t) noexcept
+{
+    free(memory);
+}
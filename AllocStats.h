@@ -0,0 +1,158 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Heap allocation counts and bytes per subsystem, fed by the replaced global operator new
+// (AllocHooks.cpp) and SDL's memory functions. Counting is opt-in: until enable() every
+// hook costs one relaxed load. Allocations are charged to the subsystem the allocating
+// thread is in, set with a Scope; the part SDL made internally is also tallied on its own,
+// so it can be told apart from the game's (the software renderer allocates while drawing
+// triangles).
+class AllocStats
+{
+public:
+    enum Subsystem
+    {
+        ALLOC_OTHER,
+        ALLOC_RENDER,
+        ALLOC_INPUT,
+        ALLOC_AI,
+        ALLOC_ASSETS,
+        ALLOC_SUBSYSTEMS
+    };
+
+    struct Counts
+    {
+        uint64_t allocations[ALLOC_SUBSYSTEMS] = {};
+        uint64_t bytes[ALLOC_SUBSYSTEMS] = {};
+        // included in the above
+        uint64_t sdlAllocations = 0, sdlBytes = 0;
+
+        uint64_t totalAllocations() const
+        {
+            uint64_t total = 0;
+            for (int s = 0; s < ALLOC_SUBSYSTEMS; s++)
+                total += allocations[s];
+            return total;
+        }
+        uint64_t totalBytes() const
+        {
+            uint64_t total = 0;
+            for (int s = 0; s < ALLOC_SUBSYSTEMS; s++)
+                total += bytes[s];
+            return total;
+        }
+        // what was allocated between an earlier snapshot and this one
+        Counts since(const Counts &earlier) const
+        {
+            Counts d;
+            for (int s = 0; s < ALLOC_SUBSYSTEMS; s++)
+            {
+                d.allocations[s] = allocations[s] - earlier.allocations[s];
+                d.bytes[s] = bytes[s] - earlier.bytes[s];
+            }
+            d.sdlAllocations = sdlAllocations - earlier.sdlAllocations;
+            d.sdlBytes = sdlBytes - earlier.sdlBytes;
+            return d;
+        }
+        void add(const Counts &other)
+        {
+            for (int s = 0; s < ALLOC_SUBSYSTEMS; s++)
+            {
+                allocations[s] += other.allocations[s];
+                bytes[s] += other.bytes[s];
+            }
+            sdlAllocations += other.sdlAllocations;
+            sdlBytes += other.sdlBytes;
+        }
+    };
+
+    static const char *name(int subsystem)
+    {
+        static const char *const names[ALLOC_SUBSYSTEMS] = {"other", "render", "input", "ai", "assets"};
+        return names[subsystem];
+    }
+    static void enable()
+    {
+        on().store(true, std::memory_order_relaxed);
+    }
+    static bool enabled()
+    {
+        return on().load(std::memory_order_relaxed);
+    }
+    // called by the allocation hooks
+    static void count(size_t size, bool bySdl = false)
+    {
+        if (!enabled())
+            return;
+        Table &t = table();
+        int s = current();
+        t.allocations[s].fetch_add(1, std::memory_order_relaxed);
+        t.bytes[s].fetch_add(size, std::memory_order_relaxed);
+        if (bySdl)
+        {
+            t.sdlAllocations.fetch_add(1, std::memory_order_relaxed);
+            t.sdlBytes.fetch_add(size, std::memory_order_relaxed);
+        }
+    }
+    static Counts snapshot()
+    {
+        Counts c;
+        for (int s = 0; s < ALLOC_SUBSYSTEMS; s++)
+        {
+            c.allocations[s] = table().allocations[s].load(std::memory_order_relaxed);
+            c.bytes[s] = table().bytes[s].load(std::memory_order_relaxed);
+        }
+        c.sdlAllocations = table().sdlAllocations.load(std::memory_order_relaxed);
+        c.sdlBytes = table().sdlBytes.load(std::memory_order_relaxed);
+        return c;
+    }
+
+    // charges this thread's allocations to a subsystem while in scope
+    class Scope
+    {
+    public:
+        explicit Scope(Subsystem subsystem) : previous(current())
+        {
+            current() = subsystem;
+        }
+        ~Scope()
+        {
+            current() = previous;
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        int previous;
+    };
+
+private:
+    struct Table
+    {
+        std::atomic<uint64_t> allocations[ALLOC_SUBSYSTEMS];
+        std::atomic<uint64_t> bytes[ALLOC_SUBSYSTEMS];
+        std::atomic<uint64_t> sdlAllocations, sdlBytes;
+    };
+    // zero initialized statics, usable before any constructor runs
+    static Table &table()
+    {
+        static Table counters;
+        return counters;
+    }
+    static std::atomic<bool> &on()
+    {
+        static std::atomic<bool> flag{false};
+        return flag;
+    }
+    static int &current()
+    {
+        thread_local int subsystem = ALLOC_OTHER;
+        return subsystem;
+    }
+};
+
+#endif
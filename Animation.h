@@ -0,0 +1,195 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <algorithm>
+
+// Short UI animations advanced in fixed time steps and drawn at a point interpolated between
+// the last two steps, so their speed doesn't depend on the frame rate. All state lives in a
+// fixed pool: starting, updating and reading animations never allocates.
+class Animator
+{
+public:
+    // animations running at once, starting more while the pool is full is ignored
+    static const int CAPACITY = 32;
+    // simulation rate, independent of how often frames are presented
+    static constexpr double STEP_MS = 1000.0 / 120;
+    // steps taken by one update at most, so a stalled frame doesn't fast-forward in a burst
+    static const int MAX_STEPS = 30;
+
+    // what is animated, together with a key (such as the cell) it names one animation
+    enum Kind
+    {
+        PIECE_POP,
+        WIN_SWEEP,
+        CAT_IDLE
+    };
+
+    // disabled animations finish as soon as they start
+    void setEnabled(bool on)
+    {
+        enabled = on;
+        if (!enabled)
+            cancelAll();
+    }
+    bool isEnabled() const
+    {
+        return enabled;
+    }
+    // starts or restarts an animation, which holds at progress 0 for delayMs first
+    void start(Kind kind, int key, double durationMs, double delayMs = 0)
+    {
+        if (!enabled || durationMs <= 0)
+            return;
+        Slot *slot = find(kind, key);
+        if (!slot)
+        {
+            for (Slot &s : slots)
+            {
+                if (!s.used)
+                {
+                    slot = &s;
+                    break;
+                }
+            }
+            if (!slot)
+                return;
+            running++;
+        }
+        // the first update after an idle stretch only sets the clock
+        if (running == 1)
+            lastMs = -1;
+        slot->used = true;
+        slot->kind = kind;
+        slot->key = key;
+        slot->steps = std::max(1, static_cast<int>(durationMs / STEP_MS + 0.5));
+        slot->elapsed = -static_cast<int>(delayMs / STEP_MS + 0.5);
+        slot->previous = slot->current = 0;
+    }
+    void cancel(Kind kind)
+    {
+        for (Slot &s : slots)
+        {
+            if (s.used && s.kind == kind)
+                release(s);
+        }
+    }
+    void cancelAll()
+    {
+        for (Slot &s : slots)
+        {
+            if (s.used)
+                release(s);
+        }
+    }
+    bool active() const
+    {
+        return running > 0;
+    }
+    bool isRunning(Kind kind, int key) const
+    {
+        return find(kind, key) != nullptr;
+    }
+
+    // advances every animation to nowMs in whole steps, the remainder becomes the
+    // interpolation factor. Returns true if anything was animating, so the frame is redrawn.
+    bool update(double nowMs)
+    {
+        if (running == 0)
+            return false;
+        if (lastMs < 0)
+            lastMs = nowMs;
+        accumulator += nowMs - lastMs;
+        lastMs = nowMs;
+        int steps = 0;
+        while (accumulator >= STEP_MS && steps < MAX_STEPS)
+        {
+            step();
+            // the last animation finished and release reset the clock, the next one starts fresh
+            if (running == 0)
+                return true;
+            accumulator -= STEP_MS;
+            steps++;
+        }
+        if (steps == MAX_STEPS)
+            accumulator = 0;
+        alpha = static_cast<float>(accumulator / STEP_MS);
+        return true;
+    }
+    // progress from 0 to 1, interpolated between the last two steps. Anything not running
+    // counts as finished, so pieces placed without an animation are simply drawn whole.
+    float progress(Kind kind, int key) const
+    {
+        const Slot *slot = find(kind, key);
+        if (!slot)
+            return 1;
+        return slot->previous + (slot->current - slot->previous) * alpha;
+    }
+
+    // overshoots a little before settling, for things popping in
+    static float easeOutBack(float t)
+    {
+        const float c = 1.70158f;
+        float u = t - 1;
+        return 1 + (c + 1) * u * u * u + c * u * u;
+    }
+    static float easeOutCubic(float t)
+    {
+        float u = 1 - t;
+        return 1 - u * u * u;
+    }
+
+private:
+    struct Slot
+    {
+        bool used;
+        Kind kind;
+        int key;
+        int steps, elapsed; // elapsed starts negative during the delay
+        float previous, current;
+    };
+    Slot slots[CAPACITY] = {};
+    int running = 0;
+    bool enabled = true;
+    double lastMs = -1, accumulator = 0;
+    float alpha = 0;
+
+    const Slot *find(Kind kind, int key) const
+    {
+        for (const Slot &s : slots)
+        {
+            if (s.used && s.kind == kind && s.key == key)
+                return &s;
+        }
+        return nullptr;
+    }
+    Slot *find(Kind kind, int key)
+    {
+        return const_cast<Slot *>(static_cast<const Animator *>(this)->find(kind, key));
+    }
+    void release(Slot &s)
+    {
+        s.used = false;
+        running--;
+        if (running == 0)
+            accumulator = alpha = 0;
+    }
+    void step()
+    {
+        for (Slot &s : slots)
+        {
+            if (!s.used)
+                continue;
+            // the last step only shows its end state once, then the animation is done
+            if (s.current >= 1)
+            {
+                release(s);
+                continue;
+            }
+            s.elapsed++;
+            s.previous = s.current;
+            s.current = s.elapsed <= 0 ? 0 : std::min(1.0f, static_cast<float>(s.elapsed) / s.steps);
+        }
+    }
+};
+
+#endif
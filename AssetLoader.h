@@ -0,0 +1,138 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "AllocStats.h"
+
+// Decodes image files into surfaces on worker threads, so reading and decoding overlap each
+// other and the renderer's startup. Files are picked up in the order given, put the ones
+// needed first at the front. Only decoding happens here: textures belong to the renderer's
+// thread, which takes the surfaces once they are ready and uploads them itself.
+// A path given more than once is decoded once, every index of it gets a shared handle to
+// the same surface, which is freed once the last handle is gone.
+class AssetLoader
+{
+public:
+    // workers started for threads = 0 at least, reads from slow storage mostly wait
+    static const unsigned MIN_WORKERS = 4;
+
+    // decodes one file, returns null on failure. Called on the worker threads.
+    typedef std::function<SDL_Surface *(const char *path)> Decoder;
+    // reference counted surface, the same pointer for the same path
+    typedef std::shared_ptr<SDL_Surface> Image;
+
+    ~AssetLoader()
+    {
+        finish();
+    }
+    // starts decoding count paths on up to threads workers (0 picks the hardware concurrency),
+    // the paths have to stay valid until finish
+    void start(const char *const *paths, int count, Decoder decoder, int threads = 0)
+    {
+        files = paths;
+        total = count;
+        decode = decoder;
+        images.assign(count, nullptr);
+        done.assign(count, 0);
+        first.assign(count, 0);
+        pendingTakes.assign(count, 0);
+        for (int i = 0; i < count; i++)
+        {
+            first[i] = i;
+            for (int j = 0; j < i; j++)
+            {
+                if (strcmp(paths[j], paths[i]) == 0)
+                {
+                    first[i] = j;
+                    break;
+                }
+            }
+            pendingTakes[first[i]]++;
+        }
+        next = 0;
+        if (threads <= 0)
+            threads = std::max(MIN_WORKERS, std::thread::hardware_concurrency());
+        threads = std::min(threads, count);
+        for (int t = 0; t < threads; t++)
+            workers.emplace_back([this]()
+                                 { run(); });
+    }
+    bool ready(int index)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return done[first[index]] != 0;
+    }
+    // waits until the file is decoded and returns a handle to its surface, null if it failed
+    // to load. The loader lets go of its own reference once every index of the path was taken.
+    Image take(int index)
+    {
+        int source = first[index];
+        std::unique_lock<std::mutex> lock(mutex);
+        decoded.wait(lock, [&]()
+                     { return done[source] != 0; });
+        Image image = images[source];
+        if (pendingTakes[source] > 0 && --pendingTakes[source] == 0)
+            images[source] = nullptr;
+        return image;
+    }
+    // distinct paths among the ones given
+    int uniqueCount() const
+    {
+        int count = 0;
+        for (int i = 0; i < total; i++)
+            count += first[i] == i;
+        return count;
+    }
+    // waits for the workers to stop, files nobody started on are skipped. Call before SDL_Quit.
+    void finish()
+    {
+        // nothing left to pick up
+        next = total;
+        for (std::thread &worker : workers)
+            worker.join();
+        workers.clear();
+    }
+
+private:
+    const char *const *files = nullptr;
+    int total = 0;
+    Decoder decode = nullptr;
+    std::atomic<int> next{0};
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable decoded;
+    std::vector<Image> images;
+    std::vector<char> done;
+    // index of the first occurrence of each path, and the takes left for each first occurrence
+    std::vector<int> first, pendingTakes;
+
+    void run()
+    {
+        AllocStats::Scope allocScope(AllocStats::ALLOC_ASSETS);
+        for (;;)
+        {
+            int index = next.fetch_add(1);
+            if (index >= total)
+                return;
+            if (first[index] != index)
+                continue;
+            SDL_Surface *surface = decode(files[index]);
+            Image image = surface ? Image(surface, SDL_FreeSurface) : nullptr;
+            std::lock_guard<std::mutex> lock(mutex);
+            images[index] = image;
+            done[index] = 1;
+            decoded.notify_all();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "LZ4Block.h"
+#include "Trace.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Many images in one file: a header, an index of every image and its LZ4 compressed pixels,
+// already decoded and converted to ARGB8888, the format the atlas pages are uploaded in.
+// Loading an image is one decompression straight into the pixels of a new surface, with no
+// file to open, nothing to parse and no pixel format to convert.
+// The pack is used in place, either memory mapped or from bytes compiled into the
+// executable, and is read only, so any number of threads can load from it at once.
+// Written by tools/PackAssets (make pack).
+//
+// Layout, little endian: Header, Entry[count], the path strings, then the compressed
+// pixel blobs. Offsets are from the start of the pack.
+class AssetPack
+{
+public:
+    static const uint32_t MAGIC = 0x4B504343; // "CCPK"
+    static const uint32_t VERSION = 2;
+    // of every image, version 1 packs could hold other formats
+    static const uint32_t PIXEL_FORMAT = SDL_PIXELFORMAT_ARGB8888;
+
+    struct Header
+    {
+        uint32_t magic, version, count, reserved;
+    };
+    struct Entry
+    {
+        uint32_t pathOffset, pathLength;
+        uint64_t dataOffset;
+        uint32_t compressedSize;
+        uint32_t width, height, pitch;
+        uint32_t format; // SDL_PixelFormatEnum of the pixels
+        uint32_t reserved;
+    };
+    static_assert(sizeof(Header) == 16 && sizeof(Entry) == 40, "the pack layout must not depend on padding");
+
+    AssetPack() = default;
+    AssetPack(const AssetPack &) = delete;
+    AssetPack &operator=(const AssetPack &) = delete;
+    ~AssetPack()
+    {
+        close();
+    }
+
+    // maps a pack file, the pages are only read once an image needs them
+    bool openFile(const char *path)
+    {
+        close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return fail(path, "can't be opened");
+        LARGE_INTEGER fileSize;
+        HANDLE mapping = GetFileSizeEx(file, &fileSize) ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        CloseHandle(file);
+        if (!mapping)
+            return fail(path, "can't be mapped");
+        const void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (!view)
+            return fail(path, "can't be mapped");
+        size_t size = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int file = ::open(path, O_RDONLY);
+        if (file < 0)
+            return fail(path, "can't be opened");
+        struct stat info;
+        void *view = fstat(file, &info) == 0 && info.st_size > 0 ? mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+        ::close(file);
+        if (view == MAP_FAILED)
+            return fail(path, "can't be mapped");
+        size_t size = static_cast<size_t>(info.st_size);
+#endif
+        mapped = true;
+        return attach(static_cast<const uint8_t *>(view), size, path);
+    }
+    // uses a pack already in memory, such as one embedded in the executable
+    bool openMemory(const void *data, size_t size, const char *name)
+    {
+        close();
+        return attach(static_cast<const uint8_t *>(data), size, name);
+    }
+    void close()
+    {
+        if (mapped && bytes)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(bytes);
+#else
+            munmap(const_cast<uint8_t *>(bytes), byteCount);
+#endif
+        }
+        mapped = false;
+        bytes = nullptr;
+        byteCount = 0;
+        entries = nullptr;
+        count = 0;
+    }
+    bool isOpen() const
+    {
+        return bytes != nullptr;
+    }
+    int size() const
+    {
+        return static_cast<int>(count);
+    }
+    // the entry of an image by the path it was packed from, null if it isn't in the pack
+    const Entry *find(const char *path) const
+    {
+        size_t length = strlen(path);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const Entry &e = entries[i];
+            if (e.pathLength == length && memcmp(bytes + e.pathOffset, path, length) == 0)
+                return &e;
+        }
+        return nullptr;
+    }
+
+    // decompresses an image into a new surface, the caller owns it
+    SDL_Surface *load(const Entry &entry) const
+    {
+        TRACE_SCOPE("AssetPack::load");
+        SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, entry.width, entry.height, SDL_BITSPERPIXEL(entry.format), entry.format);
+        if (!surface)
+            return nullptr;
+        const uint8_t *blob = bytes + entry.dataOffset;
+        size_t size = static_cast<size_t>(entry.pitch) * entry.height;
+        bool decompressed;
+        if (surface->pitch == static_cast<int>(entry.pitch))
+        {
+            decompressed = LZ4Block::decompress(blob, entry.compressedSize, static_cast<uint8_t *>(surface->pixels), size);
+        }
+        else
+        {
+            // rows packed with another alignment than this SDL uses, go through a copy
+            std::vector<uint8_t> pixels(size);
+            decompressed = LZ4Block::decompress(blob, entry.compressedSize, pixels.data(), size);
+            size_t row = std::min<size_t>(entry.pitch, surface->pitch);
+            for (uint32_t y = 0; decompressed && y < entry.height; y++)
+                memcpy(static_cast<uint8_t *>(surface->pixels) + y * surface->pitch, pixels.data() + y * entry.pitch, row);
+        }
+        if (!decompressed)
+        {
+            SDL_FreeSurface(surface);
+            SDL_SetError("Corrupt image in the asset pack");
+            return nullptr;
+        }
+        return surface;
+    }
+
+private:
+    const uint8_t *bytes = nullptr;
+    size_t byteCount = 0;
+    bool mapped = false;
+    const Entry *entries = nullptr;
+    uint32_t count = 0;
+
+    static bool fail(const char *name, const char *reason)
+    {
+        std::cerr << "Asset pack " << name << " " << reason << "!" << std::endl;
+        return false;
+    }
+    // checks the header and that the index stays inside the pack, blobs are checked as they load
+    bool attach(const uint8_t *data, size_t size, const char *name)
+    {
+        bytes = data;
+        byteCount = size;
+        Header header;
+        if (size < sizeof(header))
+            return closeWith(name, "is too small");
+        memcpy(&header, data, sizeof(header));
+        if (header.magic != MAGIC || header.version != VERSION)
+            return closeWith(name, "is not a version 2 asset pack, run make pack");
+        if (header.count > (size - sizeof(header)) / sizeof(Entry))
+            return closeWith(name, "is truncated");
+        const Entry *index = reinterpret_cast<const Entry *>(data + sizeof(header));
+        for (uint32_t i = 0; i < header.count; i++)
+        {
+            const Entry &e = index[i];
+            bool inside = e.pathOffset <= size && e.pathLength <= size - e.pathOffset && e.dataOffset <= size &&
+                          e.compressedSize <= size - e.dataOffset && e.format == PIXEL_FORMAT && e.pitch >= e.width * 4;
+            if (!inside)
+                return closeWith(name, "has a corrupt index");
+        }
+        entries = index;
+        count = header.count;
+        return true;
+    }
+    bool closeWith(const char *name, const char *reason)
+    {
+        close();
+        return fail(name, reason);
+    }
+};
+
+#endif
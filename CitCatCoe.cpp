@@ -1,12 +1,60 @@
 #include <SDL2/SDL.h>
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
 #include <vector>
 #include <cmath>
-#include <map>
+#include <algorithm>
+#include <string>
+#include "FramePacer.h"
+#include "Animation.h"
+#include "PerfLog.h"
+#include "Trace.h"
+#include "AllocStats.h"
+#include "InputLatency.h"
+#include "AssetLoader.h"
+#include "EmbeddedAssets.h"
+#include "AssetPack.h"
 
 using namespace std;
 
+// every C++ heap allocation goes through the operators in AllocHooks.cpp, see AllocStats
+
+// SDL allocates through its own functions, wrap them to count those too
+SDL_malloc_func sdlMalloc;
+SDL_calloc_func sdlCalloc;
+SDL_realloc_func sdlRealloc;
+SDL_free_func sdlFree;
+void *SDLCALL countedMalloc(size_t size)
+{
+    AllocStats::count(size, true);
+    return sdlMalloc(size);
+}
+void *SDLCALL countedCalloc(size_t count, size_t size)
+{
+    AllocStats::count(count * size, true);
+    return sdlCalloc(count, size);
+}
+// growing a block counts as an allocation of its new size
+void *SDLCALL countedRealloc(void *memory, size_t size)
+{
+    AllocStats::count(size, true);
+    return sdlRealloc(memory, size);
+}
+void SDLCALL countedFree(void *memory)
+{
+    sdlFree(memory);
+}
+// call before SDL allocates anything, so every block goes through the same pair of functions
+void countSDLAllocations()
+{
+    SDL_GetOriginalMemoryFunctions(&sdlMalloc, &sdlCalloc, &sdlRealloc, &sdlFree);
+    SDL_SetMemoryFunctions(countedMalloc, countedCalloc, countedRealloc, countedFree);
+}
+
+// size the layout is designed for, the window scales it to whatever size it has
 const int SCREEN_WIDTH = 800, SCREEN_HEIGHT = 600;
 
 enum GameState
@@ -17,9 +65,88 @@ enum GameState
     STATE_EXIT
 };
 
-// function for loading textures
-SDL_Texture *loadImage(SDL_Renderer *renderer, const char *filePath)
+// every sprite the game draws, resolved to atlas rects once at load time
+enum SpriteId
+{
+    SPRITE_TITLE,
+    SPRITE_CAT_STAND,
+    SPRITE_CAT_SIT,
+    SPRITE_TWO_PLAYER_BG,
+    SPRITE_ONE_PLAYER_BG,
+    SPRITE_BACK_BUTTON_BG,
+    SPRITE_PLAY_AGAIN,
+    SPRITE_CIT,
+    SPRITE_CIT_TURN,
+    SPRITE_CIT_WIN,
+    SPRITE_COE,
+    SPRITE_COE_TURN,
+    SPRITE_COE_WIN,
+    SPRITE_COUNT
+};
+
+// image file of each sprite, indexed by SpriteId
+const char *const SPRITE_FILES[SPRITE_COUNT] = {
+    "assets/title.bmp",
+    "assets/cat_stand.bmp",
+    "assets/cat_sit.bmp",
+    "assets/twoplayer.bmp",
+    "assets/twoplayer.bmp",
+    "assets/back.bmp",
+    "assets/playAgain.bmp",
+    "assets/cit.bmp",
+    "assets/cit_turn.bmp",
+    "assets/cit_win.bmp",
+    "assets/coe.bmp",
+    "assets/coe_turn.bmp",
+    "assets/coe_win.bmp",
+};
+
+// asset pack the build embeds into the executable, see AssetPack
+const char *const EMBEDDED_PACK = "assets.pack";
+
+// sprites of the homepage and of the game screens go into separate atlas pages, so the
+// homepage can show before the rest is loaded. Both cat poses are on the homepage page:
+// the cat hops into its other pose on every screen, and that page is always built first.
+// The game screens draw the cat from it and everything else from their own page.
+enum AtlasPage
+{
+    PAGE_HOMEPAGE,
+    PAGE_GAME,
+    PAGE_COUNT
+};
+
+// atlas page of each sprite, indexed by SpriteId
+const AtlasPage SPRITE_PAGES[SPRITE_COUNT] = {
+    PAGE_HOMEPAGE, // title
+    PAGE_HOMEPAGE, // cat stand
+    PAGE_HOMEPAGE, // cat sit
+    PAGE_HOMEPAGE, // two player bg
+    PAGE_HOMEPAGE, // one player bg
+    PAGE_GAME,     // back button
+    PAGE_GAME,     // play again
+    PAGE_GAME,     // cit
+    PAGE_GAME,     // cit turn
+    PAGE_GAME,     // cit win
+    PAGE_GAME,     // coe
+    PAGE_GAME,     // coe turn
+    PAGE_GAME,     // coe win
+};
+
+// atlas page of the sprites loaded from the file, PAGE_COUNT for files that aren't sprites
+AtlasPage filePage(const char *filePath)
+{
+    for (int i = 0; i < SPRITE_COUNT; i++)
+    {
+        if (strcmp(SPRITE_FILES[i], filePath) == 0)
+            return SPRITE_PAGES[i];
+    }
+    return PAGE_COUNT;
+}
+
+// function for loading images, the caller owns the surface
+SDL_Surface *loadSurface(const char *filePath)
 {
+    TRACE_SCOPE("loadSurface");
     // initialize image
     SDL_Surface *surface = SDL_LoadBMP(filePath);
     if (!surface)
@@ -27,12 +154,650 @@ SDL_Texture *loadImage(SDL_Renderer *renderer, const char *filePath)
         cerr << "Unable to load image: " << filePath << "! SDL_Error: " << SDL_GetError() << endl;
         return nullptr;
     }
+    return surface;
+}
+
+// loads an image from the asset pack, straight from its compressed pixels. Images that
+// aren't packed (or no pack at all) are loaded from their files instead.
+SDL_Surface *loadPackedSurface(const AssetPack &pack, const char *filePath)
+{
+    const AssetPack::Entry *entry = pack.isOpen() ? pack.find(filePath) : nullptr;
+    if (!entry)
+        return loadSurface(filePath);
+    SDL_Surface *surface = pack.load(*entry);
+    if (!surface)
+    {
+        cerr << "Unable to load packed image: " << filePath << "! SDL_Error: " << SDL_GetError() << endl;
+        return nullptr;
+    }
+    return surface;
+}
 
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_FreeSurface(surface);
-    return texture;
+double clockMs()
+{
+    return SDL_GetPerformanceCounter() * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+// video memory a texture takes, without whatever padding the driver adds
+size_t textureBytes(SDL_Texture *texture)
+{
+    Uint32 format;
+    int w, h;
+    if (!texture || SDL_QueryTexture(texture, &format, nullptr, &w, &h) != 0)
+        return 0;
+    return static_cast<size_t>(w) * h * SDL_BYTESPERPIXEL(format);
 }
 
+// part of an atlas texture to draw
+struct Sprite
+{
+    SDL_Texture *texture;
+    SDL_Rect rect;
+};
+
+// packs sprites into atlas textures, one page per build, so drawing the sprites of one
+// page never switches textures
+class TextureAtlas
+{
+private:
+    // empty border around each sprite, filled with copies of its edge so filtered sampling never bleeds
+    static const int PADDING = 1;
+
+    struct Entry
+    {
+        SpriteId id;
+        AssetLoader::Image surface;
+        SDL_Rect rect;
+        // earlier entry with the same surface whose pixels this sprite shares, or -1
+        int sameAs;
+    };
+    vector<Entry> entries;
+    Sprite sprites[SPRITE_COUNT] = {};
+    vector<SDL_Texture *> pages;
+    SDL_ScaleMode scaleMode = SDL_ScaleModeNearest;
+    double uploadMs = 0, convertMs = 0;
+    int convertedSprites = 0;
+
+    // shelf packing: tallest sprites first, rows filled left to right, returns the atlas height
+    int pack(int width)
+    {
+        vector<Entry *> order;
+        for (Entry &entry : entries)
+        {
+            if (entry.sameAs < 0)
+                order.push_back(&entry);
+        }
+        sort(order.begin(), order.end(), [](const Entry *a, const Entry *b)
+             { return a->surface->h > b->surface->h; });
+        int x = 0, y = 0, shelfHeight = 0;
+        for (Entry *entry : order)
+        {
+            int w = entry->surface->w + 2 * PADDING, h = entry->surface->h + 2 * PADDING;
+            if (x + w > width)
+            {
+                x = 0;
+                y += shelfHeight;
+                shelfHeight = 0;
+            }
+            entry->rect = {x + PADDING, y + PADDING, entry->surface->w, entry->surface->h};
+            x += w;
+            shelfHeight = max(shelfHeight, h);
+        }
+        for (Entry &entry : entries)
+        {
+            if (entry.sameAs >= 0)
+                entry.rect = entries[entry.sameAs].rect;
+        }
+        return y + shelfHeight;
+    }
+    // copies a sprite's pixels as they are, alpha included. Packed images are already
+    // ARGB8888 like the atlas and copy row by row, others are converted by the blit.
+    void copySprite(SDL_Surface *surface, SDL_Surface *atlas, SDL_Rect rect)
+    {
+        if (surface->format->format == atlas->format->format)
+        {
+            const Uint8 *src = static_cast<const Uint8 *>(surface->pixels);
+            Uint8 *dst = static_cast<Uint8 *>(atlas->pixels) + rect.y * atlas->pitch + rect.x * 4;
+            for (int y = 0; y < surface->h; y++)
+                memcpy(dst + y * atlas->pitch, src + y * surface->pitch, surface->w * 4);
+            return;
+        }
+        double start = clockMs();
+        SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(surface, nullptr, atlas, &rect);
+        convertMs += clockMs() - start;
+        convertedSprites++;
+    }
+    // ARGB8888 if the renderer takes it, otherwise the first format it lists that keeps alpha
+    static Uint32 textureFormat(const SDL_RendererInfo &info)
+    {
+        Uint32 fallback = SDL_PIXELFORMAT_UNKNOWN;
+        for (Uint32 i = 0; i < info.num_texture_formats; i++)
+        {
+            Uint32 format = info.texture_formats[i];
+            if (format == SDL_PIXELFORMAT_ARGB8888)
+                return format;
+            if (fallback == SDL_PIXELFORMAT_UNKNOWN && !SDL_ISPIXELFORMAT_FOURCC(format) && !SDL_ISPIXELFORMAT_INDEXED(format) &&
+                SDL_ISPIXELFORMAT_ALPHA(format))
+                fallback = format;
+        }
+        return fallback == SDL_PIXELFORMAT_UNKNOWN ? static_cast<Uint32>(SDL_PIXELFORMAT_ARGB8888) : fallback;
+    }
+    // copies the outermost pixels of a placed sprite into its padding
+    static void extrudeEdges(SDL_Surface *atlas, const SDL_Rect &r)
+    {
+        Uint32 *pixels = static_cast<Uint32 *>(atlas->pixels);
+        int stride = atlas->pitch / 4;
+        for (int y = r.y; y < r.y + r.h; y++)
+        {
+            pixels[y * stride + r.x - 1] = pixels[y * stride + r.x];
+            pixels[y * stride + r.x + r.w] = pixels[y * stride + r.x + r.w - 1];
+        }
+        for (int x = r.x - 1; x <= r.x + r.w; x++)
+        {
+            pixels[(r.y - 1) * stride + x] = pixels[r.y * stride + x];
+            pixels[(r.y + r.h) * stride + x] = pixels[(r.y + r.h - 1) * stride + x];
+        }
+    }
+
+public:
+    // keeps a reference to the surface until the next build, which may be null if loading
+    // failed. Sprites added with the same surface share one copy of it in the atlas.
+    void add(SpriteId id, const AssetLoader::Image &surface)
+    {
+        int sameAs = -1;
+        for (size_t i = 0; i < entries.size() && surface; i++)
+        {
+            if (entries[i].surface == surface && entries[i].sameAs < 0)
+                sameAs = static_cast<int>(i);
+        }
+        entries.push_back({id, surface, {0, 0, 0, 0}, sameAs});
+    }
+    // packs the sprites added since the last build into a new page texture and lets go of
+    // their surfaces. Every sprite added has to be loaded so drawing never meets a missing one.
+    bool build(SDL_Renderer *renderer)
+    {
+        TRACE_SCOPE("TextureAtlas::build");
+        for (const Entry &entry : entries)
+        {
+            if (!entry.surface)
+            {
+                cerr << "Error: Failed to load texture '" << SPRITE_FILES[entry.id] << "'!" << endl;
+                return false;
+            }
+        }
+        SDL_RendererInfo info;
+        SDL_GetRendererInfo(renderer, &info);
+        int maxSize = info.max_texture_width > 0 ? min(info.max_texture_width, info.max_texture_height) : 4096;
+
+        // try power of two widths and keep the one wasting the least area
+        int widest = 0;
+        for (const Entry &entry : entries)
+            widest = max(widest, entry.surface->w + 2 * PADDING);
+        int bestWidth = 0, bestHeight = 0;
+        for (int width = 64; width <= maxSize; width *= 2)
+        {
+            if (width < widest)
+                continue;
+            int height = pack(width);
+            if (height <= maxSize && (bestWidth == 0 || (long long)width * height < (long long)bestWidth * bestHeight))
+            {
+                bestWidth = width;
+                bestHeight = height;
+            }
+        }
+        if (bestWidth == 0)
+        {
+            cerr << "Error: Sprites don't fit in a " << maxSize << "x" << maxSize << " atlas!" << endl;
+            return false;
+        }
+        pack(bestWidth);
+
+        SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, bestWidth, bestHeight, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (!atlas)
+        {
+            cerr << "Error: Unable to create atlas! SDL_Error: " << SDL_GetError() << endl;
+            return false;
+        }
+        for (Entry &entry : entries)
+        {
+            if (entry.sameAs < 0)
+            {
+                copySprite(entry.surface.get(), atlas, entry.rect);
+                extrudeEdges(atlas, entry.rect);
+            }
+            entry.surface.reset();
+        }
+        // the page goes up as it is when the renderer takes ARGB8888, as every SDL backend does
+        Uint32 format = textureFormat(info);
+        if (format != SDL_PIXELFORMAT_ARGB8888)
+        {
+            double start = clockMs();
+            SDL_Surface *converted = SDL_ConvertSurfaceFormat(atlas, format, 0);
+            SDL_FreeSurface(atlas);
+            atlas = converted;
+            convertMs += clockMs() - start;
+            if (!atlas)
+            {
+                cerr << "Error: Unable to convert atlas! SDL_Error: " << SDL_GetError() << endl;
+                return false;
+            }
+        }
+        double start = clockMs();
+        SDL_Texture *texture = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STATIC, atlas->w, atlas->h);
+        if (texture && SDL_UpdateTexture(texture, nullptr, atlas->pixels, atlas->pitch) != 0)
+        {
+            SDL_DestroyTexture(texture);
+            texture = nullptr;
+        }
+        uploadMs += clockMs() - start;
+        SDL_FreeSurface(atlas);
+        if (!texture)
+        {
+            cerr << "Error: Unable to create atlas texture! SDL_Error: " << SDL_GetError() << endl;
+            return false;
+        }
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        SDL_SetTextureScaleMode(texture, scaleMode);
+        pages.push_back(texture);
+        for (const Entry &entry : entries)
+            sprites[entry.id] = {texture, entry.rect};
+        entries.clear();
+        return true;
+    }
+    const Sprite &get(SpriteId id) const
+    {
+        return sprites[id];
+    }
+    // linear filtering for scaled layouts, nearest keeps 1:1 sprites exact. Also applies to
+    // pages built later.
+    void setScaleMode(SDL_ScaleMode mode)
+    {
+        scaleMode = mode;
+        for (SDL_Texture *page : pages)
+            SDL_SetTextureScaleMode(page, mode);
+    }
+    // video memory of the page textures
+    size_t textureBytes() const
+    {
+        size_t bytes = 0;
+        for (SDL_Texture *page : pages)
+            bytes += ::textureBytes(page);
+        return bytes;
+    }
+    int pageCount() const
+    {
+        return static_cast<int>(pages.size());
+    }
+    // time spent uploading pages, and converting pixels that weren't in the page format along
+    // with the sprites that needed it. Packed images never need converting.
+    double uploadTime() const
+    {
+        return uploadMs;
+    }
+    double conversionTime() const
+    {
+        return convertMs;
+    }
+    int convertedSpriteCount() const
+    {
+        return convertedSprites;
+    }
+    void destroy()
+    {
+        entries.clear();
+        for (Sprite &sprite : sprites)
+            sprite = {nullptr, {0, 0, 0, 0}};
+        for (SDL_Texture *page : pages)
+            SDL_DestroyTexture(page);
+        pages.clear();
+    }
+};
+
+// collects a frame's lines, sprites and filled geometry into contiguous arrays and
+// submits them with one call per run of primitives that draw the same way, in submission order
+class PrimitiveBatch
+{
+private:
+    enum RunType
+    {
+        RUN_GEOMETRY, // SDL_RenderGeometry, textured or not
+        RUN_LINES     // SDL_RenderDrawLines, one connected strip
+    };
+    struct Run
+    {
+        RunType type;
+        SDL_Texture *texture; // nullptr for untextured geometry
+        SDL_Color color;      // line color
+        int first, count;     // range in indices, or in pointList for lines
+    };
+    vector<SDL_Vertex> vertices;
+    vector<int> indices;
+    vector<SDL_FPoint> pointList;
+    vector<Run> runs;
+    int calls = 0;
+
+    static bool sameColor(SDL_Color a, SDL_Color b)
+    {
+        return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+    }
+    Run &newRun(RunType type, SDL_Texture *texture, SDL_Color color)
+    {
+        Run run = {type, texture, color, type == RUN_GEOMETRY ? (int)indices.size() : (int)pointList.size(), 0};
+        runs.push_back(run);
+        return runs.back();
+    }
+    // continues the last run if it draws the same way, otherwise starts a new one
+    Run &runFor(RunType type, SDL_Texture *texture, SDL_Color color)
+    {
+        if (!runs.empty())
+        {
+            Run &last = runs.back();
+            if (last.type == type && last.texture == texture && (type == RUN_GEOMETRY || sameColor(last.color, color)))
+                return last;
+        }
+        return newRun(type, texture, color);
+    }
+    void quad(SDL_Texture *texture, const SDL_FPoint corners[4], const SDL_FPoint uv[4], SDL_Color color)
+    {
+        Run &run = runFor(RUN_GEOMETRY, texture, color);
+        int base = vertices.size();
+        for (int i = 0; i < 4; i++)
+            vertices.push_back({corners[i], color, uv[i]});
+        const int order[6] = {0, 1, 2, 0, 2, 3};
+        for (int i = 0; i < 6; i++)
+            indices.push_back(base + order[i]);
+        run.count += 6;
+    }
+
+public:
+    // one pixel wide line including both end points, like SDL_RenderDrawLine
+    void line(int x1, int y1, int x2, int y2, SDL_Color color)
+    {
+        if (x1 == x2 || y1 == y2)
+        {
+            // axis aligned lines are exact one pixel wide quads, so they join the geometry run
+            float left = min(x1, x2), top = min(y1, y2);
+            float right = max(x1, x2) + 1, bottom = max(y1, y2) + 1;
+            SDL_FPoint corners[4] = {{left, top}, {right, top}, {right, bottom}, {left, bottom}};
+            SDL_FPoint uv[4] = {};
+            quad(nullptr, corners, uv, color);
+            return;
+        }
+        // slanted lines keep SDL's own line rasterization, which geometry can't match on
+        // renderers without subpixel precision, and join the last strip when they continue it
+        SDL_FPoint start = {(float)x1, (float)y1}, end = {(float)x2, (float)y2};
+        if (!runs.empty() && runs.back().type == RUN_LINES && sameColor(runs.back().color, color))
+        {
+            const SDL_FPoint &last = pointList.back();
+            if (last.x == start.x && last.y == start.y)
+            {
+                pointList.push_back(end);
+                runs.back().count++;
+                return;
+            }
+        }
+        Run &run = newRun(RUN_LINES, nullptr, color);
+        pointList.push_back(start);
+        pointList.push_back(end);
+        run.count = 2;
+    }
+    void fillRect(const SDL_Rect &r, SDL_Color color)
+    {
+        float left = r.x, top = r.y, right = r.x + r.w, bottom = r.y + r.h;
+        SDL_FPoint corners[4] = {{left, top}, {right, top}, {right, bottom}, {left, bottom}};
+        SDL_FPoint uv[4] = {};
+        quad(nullptr, corners, uv, color);
+    }
+    // outline matching SDL_RenderDrawRect
+    void rectOutline(const SDL_Rect &r, SDL_Color color)
+    {
+        int right = r.x + r.w - 1, bottom = r.y + r.h - 1;
+        line(r.x, r.y, right, r.y, color);
+        line(r.x, bottom, right, bottom, color);
+        line(r.x, r.y, r.x, bottom, color);
+        line(right, r.y, right, bottom, color);
+    }
+    // textured quad, like SDL_RenderCopy
+    void sprite(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect &dst)
+    {
+        // like SDL_RenderCopy, a missing texture draws nothing
+        if (!texture)
+            return;
+        SDL_FPoint uv[4] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+        if (src)
+        {
+            int w, h;
+            SDL_QueryTexture(texture, nullptr, nullptr, &w, &h);
+            float u1 = (float)src->x / w, v1 = (float)src->y / h;
+            float u2 = (float)(src->x + src->w) / w, v2 = (float)(src->y + src->h) / h;
+            uv[0] = {u1, v1};
+            uv[1] = {u2, v1};
+            uv[2] = {u2, v2};
+            uv[3] = {u1, v2};
+        }
+        SDL_FPoint corners[4] = {{(float)dst.x, (float)dst.y}, {(float)(dst.x + dst.w), (float)dst.y}, {(float)(dst.x + dst.w), (float)(dst.y + dst.h)}, {(float)dst.x, (float)(dst.y + dst.h)}};
+        SDL_Color white = {255, 255, 255, 255};
+        quad(texture, corners, uv, white);
+    }
+    void sprite(const Sprite &image, const SDL_Rect &dst)
+    {
+        sprite(image.texture, &image.rect, dst);
+    }
+    // indexed triangles, scaled around their origin and then offset by (dx, dy)
+    void geometry(SDL_Texture *texture, const SDL_Vertex *list, int count, const int *order, int orderCount, float dx, float dy, float scale = 1)
+    {
+        Run &run = runFor(RUN_GEOMETRY, texture, list[0].color);
+        int base = vertices.size();
+        for (int i = 0; i < count; i++)
+        {
+            SDL_Vertex v = list[i];
+            v.position.x = v.position.x * scale + dx;
+            v.position.y = v.position.y * scale + dy;
+            vertices.push_back(v);
+        }
+        for (int i = 0; i < orderCount; i++)
+            indices.push_back(base + order[i]);
+        run.count += orderCount;
+    }
+    // submits everything collected since the last flush
+    void flush(SDL_Renderer *renderer)
+    {
+        // the draw color only matters to lines, set it only when it changes
+        SDL_Color drawColor = {0, 0, 0, 0};
+        bool colorSet = false;
+        for (const Run &run : runs)
+        {
+            if (run.count == 0)
+                continue;
+            if (run.type == RUN_GEOMETRY)
+            {
+                SDL_RenderGeometry(renderer, run.texture, vertices.data(), vertices.size(), indices.data() + run.first, run.count);
+            }
+            else
+            {
+                if (!colorSet || !sameColor(drawColor, run.color))
+                {
+                    SDL_SetRenderDrawColor(renderer, run.color.r, run.color.g, run.color.b, run.color.a);
+                    drawColor = run.color;
+                    colorSet = true;
+                }
+                SDL_RenderDrawLinesF(renderer, pointList.data() + run.first, run.count);
+            }
+            calls++;
+        }
+        // clear keeps the capacity, so steady frames don't reallocate
+        vertices.clear();
+        indices.clear();
+        pointList.clear();
+        runs.clear();
+    }
+    // draw calls issued since the last call
+    int takeDrawCalls()
+    {
+        int count = calls;
+        calls = 0;
+        return count;
+    }
+};
+
+// A frame's drawing as plain commands. Building the list makes no SDL calls, so scene
+// building is its own stage that can be timed (or moved to another thread) separately.
+// submit sorts the commands by texture (in order of first use) and primitive type, so each
+// group becomes one PrimitiveBatch run, and flushes the batch. Commands are only reordered
+// within their layer: later layers still draw on top, and commands of one layer must not
+// overlap.
+class RenderList
+{
+public:
+    enum Layer : uint8_t
+    {
+        LAYER_SCENE,
+        LAYER_OVERLAY, // outlines and lines drawn over the scene
+        LAYER_DEBUG    // the perf overlay, over everything
+    };
+
+    void sprite(const Sprite &image, const SDL_Rect &dst, Layer layer = LAYER_SCENE)
+    {
+        Command &c = add(CMD_SPRITE, PRIM_TRIANGLES, layer, image.texture, {255, 255, 255, 255});
+        c.sprite = {image.rect, dst};
+    }
+    void line(int x1, int y1, int x2, int y2, SDL_Color color, Layer layer = LAYER_SCENE)
+    {
+        // slanted lines stay SDL lines, see PrimitiveBatch::line
+        Command &c = add(CMD_LINE, (x1 == x2 || y1 == y2) ? PRIM_TRIANGLES : PRIM_LINES, layer, nullptr, color);
+        c.line = {x1, y1, x2, y2};
+    }
+    void rectOutline(const SDL_Rect &r, SDL_Color color, Layer layer = LAYER_SCENE)
+    {
+        Command &c = add(CMD_RECT, PRIM_TRIANGLES, layer, nullptr, color);
+        c.rect = r;
+    }
+    void fillRect(const SDL_Rect &r, SDL_Color color, Layer layer = LAYER_SCENE)
+    {
+        Command &c = add(CMD_FILL, PRIM_TRIANGLES, layer, nullptr, color);
+        c.rect = r;
+    }
+    // the vertex and index arrays have to stay valid until submit
+    void geometry(SDL_Texture *texture, const SDL_Vertex *list, int count, const int *order, int orderCount, float dx, float dy, float scale = 1, Layer layer = LAYER_SCENE)
+    {
+        Command &c = add(CMD_GEOMETRY, PRIM_TRIANGLES, layer, texture, list[0].color);
+        c.geometry = {list, order, count, orderCount, dx, dy, scale};
+    }
+    size_t size() const
+    {
+        return commands.size();
+    }
+
+    // sorts and draws everything recorded since the last submit
+    void submit(PrimitiveBatch &batch, SDL_Renderer *renderer)
+    {
+        // in place and without allocating, the sequence keeps equal keys in recording order
+        sort(commands.begin(), commands.end(), [](const Command &a, const Command &b)
+             {
+                 if (a.layer != b.layer)
+                     return a.layer < b.layer;
+                 if (a.textureOrder != b.textureOrder)
+                     return a.textureOrder < b.textureOrder;
+                 if (a.primitive != b.primitive)
+                     return a.primitive < b.primitive;
+                 // lines are drawn per color
+                 if (a.primitive == PRIM_LINES && packColor(a.color) != packColor(b.color))
+                     return packColor(a.color) < packColor(b.color);
+                 return a.sequence < b.sequence;
+             });
+        for (const Command &c : commands)
+        {
+            if (c.type == CMD_SPRITE)
+                batch.sprite(c.texture, &c.sprite.src, c.sprite.dst);
+            else if (c.type == CMD_LINE)
+                batch.line(c.line.x1, c.line.y1, c.line.x2, c.line.y2, c.color);
+            else if (c.type == CMD_RECT)
+                batch.rectOutline(c.rect, c.color);
+            else if (c.type == CMD_FILL)
+                batch.fillRect(c.rect, c.color);
+            else
+                batch.geometry(c.texture, c.geometry.vertices, c.geometry.vertexCount, c.geometry.indices, c.geometry.indexCount, c.geometry.dx, c.geometry.dy, c.geometry.scale);
+        }
+        commands.clear();
+        textures.clear();
+        batch.flush(renderer);
+    }
+
+private:
+    enum CommandType : uint8_t
+    {
+        CMD_SPRITE,
+        CMD_LINE,
+        CMD_RECT,
+        CMD_FILL,
+        CMD_GEOMETRY
+    };
+    // what the command becomes in the batch
+    enum Primitive : uint8_t
+    {
+        PRIM_TRIANGLES,
+        PRIM_LINES
+    };
+    struct SpriteData
+    {
+        SDL_Rect src, dst;
+    };
+    struct LineData
+    {
+        int x1, y1, x2, y2;
+    };
+    struct GeometryData
+    {
+        const SDL_Vertex *vertices;
+        const int *indices;
+        int vertexCount, indexCount;
+        float dx, dy, scale;
+    };
+    struct Command
+    {
+        Layer layer;
+        Primitive primitive;
+        CommandType type;
+        uint32_t sequence;
+        // rank of the texture by when the frame first used it, sorting on it rather than the
+        // pointer keeps the order the same from run to run
+        uint32_t textureOrder;
+        SDL_Texture *texture;
+        SDL_Color color;
+        union
+        {
+            SpriteData sprite;
+            LineData line;
+            SDL_Rect rect;
+            GeometryData geometry;
+        };
+    };
+    vector<Command> commands;
+    // every texture used since the last submit, in order of first use
+    vector<SDL_Texture *> textures;
+
+    static Uint32 packColor(SDL_Color c)
+    {
+        return (Uint32)c.r << 24 | (Uint32)c.g << 16 | (Uint32)c.b << 8 | c.a;
+    }
+    Command &add(CommandType type, Primitive primitive, Layer layer, SDL_Texture *texture, SDL_Color color)
+    {
+        Command c;
+        c.layer = layer;
+        c.primitive = primitive;
+        c.type = type;
+        c.sequence = commands.size();
+        c.textureOrder = find(textures.begin(), textures.end(), texture) - textures.begin();
+        if (c.textureOrder == textures.size())
+            textures.push_back(texture);
+        c.texture = texture;
+        c.color = color;
+        commands.push_back(c);
+        return commands.back();
+    }
+};
+
 class Button
 {
 private:
@@ -45,16 +810,19 @@ public:
         rect = imgRect;
         outline = borderColor;
     }
+    void setRect(SDL_Rect imgRect)
+    {
+        rect = imgRect;
+    }
     bool isClicked(int mouseX, int mouseY)
     {
         SDL_Point p = {mouseX, mouseY};
         return SDL_PointInRect(&p, &rect);
     }
-    void renderButton(SDL_Renderer *renderer)
+    void renderButton(RenderList &list)
     {
-        // outline it
-        SDL_SetRenderDrawColor(renderer, outline.r, outline.g, outline.b, outline.a);
-        SDL_RenderDrawRect(renderer, &rect);
+        // outline it, over its background
+        list.rectOutline(rect, outline, RenderList::LAYER_OVERLAY);
     }
 };
 
@@ -160,32 +928,126 @@ public:
     }
 };
 
+// triangles of one antialiased glyph or stroke, in pixels around its own origin
+struct GlyphMesh
+{
+    // width of the edge over which alpha fades out
+    static constexpr float FEATHER = 1.0f;
+
+    vector<SDL_Vertex> vertices;
+    vector<int> indices;
+
+    void clear()
+    {
+        vertices.clear();
+        indices.clear();
+    }
+    // grid of rows x columns vertices, joined into quads
+    void addGrid(int first, int rows, int columns)
+    {
+        for (int r = 0; r + 1 < rows; r++)
+        {
+            for (int c = 0; c + 1 < columns; c++)
+            {
+                int a = first + r * columns + c, b = a + 1, d = a + columns, e = d + 1;
+                const int quad[6] = {a, b, e, a, e, d};
+                indices.insert(indices.end(), quad, quad + 6);
+            }
+        }
+    }
+    // straight stroke of the given width, feathered on all four sides
+    void addStroke(float ax, float ay, float bx, float by, float width, SDL_Color color)
+    {
+        float dx = bx - ax, dy = by - ay;
+        float length = sqrtf(dx * dx + dy * dy);
+        if (length == 0)
+            return;
+        dx /= length;
+        dy /= length;
+        float half = width / 2;
+        const float along[4] = {-FEATHER, 0, length, length + FEATHER};
+        const float across[4] = {-half - FEATHER, -half, half, half + FEATHER};
+        const Uint8 fade[4] = {0, 255, 255, 0};
+        int first = vertices.size();
+        for (int i = 0; i < 4; i++)
+        {
+            for (int j = 0; j < 4; j++)
+            {
+                SDL_Vertex v;
+                v.position = {ax + dx * along[i] - dy * across[j], ay + dy * along[i] + dx * across[j]};
+                v.color = color;
+                v.color.a = color.a * min(fade[i], fade[j]) / 255;
+                v.tex_coord = {0, 0};
+                vertices.push_back(v);
+            }
+        }
+        addGrid(first, 4, 4);
+    }
+    // circle of the given radius and stroke width, feathered inside and out
+    void addRing(float radius, float width, SDL_Color color)
+    {
+        int segments = max(24, min(128, static_cast<int>(radius)));
+        float half = width / 2;
+        const float radii[4] = {radius - half - FEATHER, radius - half, radius + half, radius + half + FEATHER};
+        const Uint8 fade[4] = {0, 255, 255, 0};
+        int first = vertices.size();
+        for (int s = 0; s <= segments; s++)
+        {
+            float angle = 2 * M_PI * s / segments;
+            float c = cosf(angle), sn = sinf(angle);
+            for (int j = 0; j < 4; j++)
+            {
+                SDL_Vertex v;
+                v.position = {c * radii[j], sn * radii[j]};
+                v.color = color;
+                v.color.a = color.a * fade[j] / 255;
+                v.tex_coord = {0, 0};
+                vertices.push_back(v);
+            }
+        }
+        addGrid(first, segments + 1, 4);
+    }
+};
+
 class Board
 {
 private:
     SDL_Rect rect;
     int cellSize;
+    // X and O meshes built once per cell size, so a frame only copies vertices
+    GlyphMesh xMesh, oMesh;
+    int meshCellSize = 0;
+    // reused every frame for the win line
+    GlyphMesh winMesh;
 
-    void drawX(SDL_Renderer *renderer, int x1, int y1, int x2, int y2)
+    float strokeWidth() const
     {
-        SDL_RenderDrawLine(renderer, x1, y1, x2, y2);
-        SDL_RenderDrawLine(renderer, x2, y1, x1, y2);
+        return max(2.0f, cellSize / 25.0f);
     }
-    void drawO(SDL_Renderer *renderer, int x, int y, int radius)
+    void updateMeshes()
     {
-        for (int angle = 0; angle < 360; angle++)
-        {
-            int dx = static_cast<int>(radius * cos(angle * M_PI / 180));
-            int dy = static_cast<int>(radius * sin(angle * M_PI / 180));
-            SDL_RenderDrawPoint(renderer, x + dx, y + dy);
-        }
+        if (meshCellSize == cellSize)
+            return;
+        SDL_Color white = {0xFF, 0xFF, 0xFF, 0xFF};
+        float radius = cellSize / 4;
+        xMesh.clear();
+        xMesh.addStroke(-radius, -radius, radius, radius, strokeWidth(), white);
+        xMesh.addStroke(radius, -radius, -radius, radius, strokeWidth(), white);
+        oMesh.clear();
+        oMesh.addRing(radius, strokeWidth(), white);
+        meshCellSize = cellSize;
     }
 
 public:
     Board(int x, int y, int w, int h)
     {
-        rect = {x, y, w, h};
-        cellSize = w / 3;
+        setRect({x, y, w, h});
+    }
+    // the meshes follow on the next render, since they are keyed by cell size
+    void setRect(SDL_Rect boardRect)
+    {
+        rect = boardRect;
+        cellSize = rect.w / 3;
     }
     bool isClicked(int mouseX, int mouseY)
     {
@@ -197,75 +1059,106 @@ public:
         row = (mouseY - rect.y) / cellSize;
         col = (mouseX - rect.x) / cellSize;
     }
-    void renderBoard(SDL_Renderer *renderer, char XOBoard[3][3], Player curr)
+    // pieces pop in and the win line sweeps across as the animator says, keyed by cell index
+    void renderBoard(RenderList &list, char XOBoard[3][3], Player curr, const Animator &animator)
     {
-        SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xFF);
-        SDL_RenderClear(renderer);
-
-        SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+        TRACE_SCOPE("Board::renderBoard");
+        SDL_Color white = {0xFF, 0xFF, 0xFF, 0xFF};
+        // grid lines get thicker with the board, one pixel at the 800x600 size
+        int gridWidth = max(1, cellSize / 100);
         // draw horizontal line
         for (int i = 1; i < 3; i++)
         {
-            SDL_RenderDrawLine(renderer, rect.x, rect.y + i * cellSize, rect.x + rect.w, rect.y + i * cellSize);
+            for (int t = 0; t < gridWidth; t++)
+                list.line(rect.x, rect.y + i * cellSize + t, rect.x + rect.w, rect.y + i * cellSize + t, white);
         }
         // draw vertical lines
         for (int i = 1; i < 3; i++)
         {
-            SDL_RenderDrawLine(renderer, rect.x + i * cellSize, rect.y, rect.x + i * cellSize, rect.y + rect.w);
+            for (int t = 0; t < gridWidth; t++)
+                list.line(rect.x + i * cellSize + t, rect.y, rect.x + i * cellSize + t, rect.y + rect.w, white);
         }
 
-        // draw X and O
+        // draw X and O from the cached meshes, they join the grid in one geometry run
+        updateMeshes();
         for (int i = 0; i < 3; i++)
         {
             // Loop through rows
             for (int j = 0; j < 3; j++)
             {
-                int x = rect.x + j * cellSize + cellSize / 2;
-                int y = rect.y + i * cellSize + cellSize / 2;
+                // centers of the middle pixel of the cell
+                float x = rect.x + j * cellSize + cellSize / 2 + 0.5f;
+                float y = rect.y + i * cellSize + cellSize / 2 + 0.5f;
 
+                float scale = Animator::easeOutBack(animator.progress(Animator::PIECE_POP, i * 3 + j));
+                if (scale <= 0)
+                    continue;
                 if (XOBoard[i][j] == 'x')
-                {
-                    drawX(renderer, x - cellSize / 4, y - cellSize / 4, x + cellSize / 4, y + cellSize / 4);
-                }
+                    list.geometry(nullptr, xMesh.vertices.data(), xMesh.vertices.size(), xMesh.indices.data(), xMesh.indices.size(), x, y, scale);
                 if (XOBoard[i][j] == 'o')
-                {
-                    drawO(renderer, x, y, cellSize / 4);
-                }
+                    list.geometry(nullptr, oMesh.vertices.data(), oMesh.vertices.size(), oMesh.indices.data(), oMesh.indices.size(), x, y, scale);
             }
         }
         // check for win and find from where to where to draw win line
-        if (curr.winner != '#')
+        float sweep = Animator::easeOutCubic(animator.progress(Animator::WIN_SWEEP, 0));
+        if (curr.winner != '#' && sweep > 0)
         {
+            float middle = static_cast<int>((curr.win_index + 0.5) * cellSize) + 0.5f;
+            float left = rect.x, top = rect.y, right = rect.x + rect.w, bottom = rect.y + rect.w;
+            float ax = 0, ay = 0, bx = 0, by = 0;
             if (curr.win_type == 'm') // main diagonal win line
             {
-                SDL_RenderDrawLine(renderer, rect.x, rect.y, rect.x + rect.w, rect.y + rect.w);
+                ax = left, ay = top, bx = right, by = bottom;
             }
             else if (curr.win_type == 's') // secondary diagonal win line
             {
-                SDL_RenderDrawLine(renderer, rect.x + rect.w, rect.y, rect.x, rect.y + rect.w);
+                ax = right, ay = top, bx = left, by = bottom;
             }
             else if (curr.win_type == 'h') // horizontal win line
             {
-                SDL_RenderDrawLine(renderer, rect.x, rect.y + (curr.win_index + 0.5) * cellSize, rect.x + rect.w, rect.y + (curr.win_index + 0.5) * cellSize);
+                ax = left, ay = top + middle, bx = right, by = top + middle;
             }
             else if (curr.win_type == 'v') // verical win line
             {
-                SDL_RenderDrawLine(renderer, rect.x + (curr.win_index + 0.5) * cellSize, rect.y, rect.x + (curr.win_index + 0.5) * cellSize, rect.y + rect.w);
+                ax = left + middle, ay = top, bx = left + middle, by = bottom;
             }
+            // the line grows from its start while sweeping
+            winMesh.clear();
+            winMesh.addStroke(ax, ay, ax + (bx - ax) * sweep, ay + (by - ay) * sweep, strokeWidth(), white);
+            if (!winMesh.vertices.empty())
+                list.geometry(nullptr, winMesh.vertices.data(), winMesh.vertices.size(), winMesh.indices.data(), winMesh.indices.size(), 0, 0, 1, RenderList::LAYER_OVERLAY);
         }
     }
 };
 
-void cleanup(SDL_Window *window, SDL_Renderer *renderer, map<string, SDL_Texture *> &textures)
+// whether every sprite of the page is decoded
+bool pageDecoded(AssetLoader &loader, AtlasPage page)
 {
-    for (auto &pair : textures)
+    for (int id = 0; id < SPRITE_COUNT; id++)
     {
-        if (pair.second)
-        {
-            SDL_DestroyTexture(pair.second);
-        }
+        if (SPRITE_PAGES[id] == page && !loader.ready(id))
+            return false;
     }
-    textures.clear();
+    return true;
+}
+
+// moves the page's sprites from the loader into the atlas, waiting for any still being
+// decoded, and uploads them as a new atlas page
+bool buildPage(TextureAtlas &atlas, AssetLoader &loader, AtlasPage page, SDL_Renderer *renderer)
+{
+    AllocStats::Scope allocScope(AllocStats::ALLOC_ASSETS);
+    for (int id = 0; id < SPRITE_COUNT; id++)
+    {
+        if (SPRITE_PAGES[id] == page)
+            atlas.add(static_cast<SpriteId>(id), loader.take(id));
+    }
+    return atlas.build(renderer);
+}
+
+void cleanup(SDL_Window *window, SDL_Renderer *renderer, TextureAtlas &atlas, AssetLoader &loader)
+{
+    loader.finish();
+    atlas.destroy();
     if (renderer)
         SDL_DestroyRenderer(renderer);
     if (window)
@@ -273,221 +1166,1002 @@ void cleanup(SDL_Window *window, SDL_Renderer *renderer, map<string, SDL_Texture
     SDL_Quit();
 }
 
+// positions of everything on screen: the SCREEN_WIDTH x SCREEN_HEIGHT design scaled
+// uniformly to the renderer output in pixels and centered. Recomputed only when the
+// output size changes, frames just read the cached rects.
+class Layout
+{
+private:
+    int outputWidth = 0, outputHeight = 0;
+    float scale = 1;
+    int offsetX = 0, offsetY = 0;
+    // output pixels per window coordinate, above 1 on high-DPI displays
+    float pixelsPerPointX = 1, pixelsPerPointY = 1;
+
+    // scales both edges, so neighbouring rects stay exactly adjacent
+    SDL_Rect place(SDL_Rect design) const
+    {
+        int left = lround(design.x * scale), top = lround(design.y * scale);
+        int right = lround((design.x + design.w) * scale), bottom = lround((design.y + design.h) * scale);
+        return {offsetX + left, offsetY + top, right - left, bottom - top};
+    }
+
+public:
+    SDL_Rect title, catStand, catSit, twoPlayerBG, onePlayerBG, backButton, playAgain, cit, coe, board;
+
+    // returns true when the output size changed and the rects were recomputed
+    bool update(SDL_Window *window, SDL_Renderer *renderer)
+    {
+        int w, h, windowW, windowH;
+        if (SDL_GetRendererOutputSize(renderer, &w, &h) != 0 || w <= 0 || h <= 0)
+            return false;
+        // offscreen renderers have no window, their output is all there is
+        windowW = w;
+        windowH = h;
+        if (window)
+            SDL_GetWindowSize(window, &windowW, &windowH);
+        pixelsPerPointX = windowW > 0 ? (float)w / windowW : 1;
+        pixelsPerPointY = windowH > 0 ? (float)h / windowH : 1;
+        if (w == outputWidth && h == outputHeight)
+            return false;
+        outputWidth = w;
+        outputHeight = h;
+
+        scale = min((float)w / SCREEN_WIDTH, (float)h / SCREEN_HEIGHT);
+        offsetX = (w - lround(SCREEN_WIDTH * scale)) / 2;
+        offsetY = (h - lround(SCREEN_HEIGHT * scale)) / 2;
+
+        title = place({(SCREEN_WIDTH - 582) / 2, 90, 582, 96});
+        catStand = place({600, 450, 140, 100});
+        catSit = place({600, 450, 110, 110});
+        twoPlayerBG = place({SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 + 60, 200, 80});
+        onePlayerBG = place({SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 - 50, 200, 80});
+        backButton = place({20, 20, 40, 40});
+        playAgain = place({370, 490, 60, 60});
+        cit = place({40, 250, 180, 90});
+        coe = place({570, 255, 180, 90});
+        // the board stays square and a whole number of cells wide
+        board = place({(SCREEN_WIDTH - 300) / 2, (SCREEN_HEIGHT - 300) / 2, 300, 300});
+        board.w = board.h = board.w / 3 * 3;
+        return true;
+    }
+    // sprites are drawn at their own size only at scale 1
+    int width() const
+    {
+        return outputWidth;
+    }
+    bool unscaled() const
+    {
+        return scale == 1;
+    }
+    // mouse events come in window coordinates, the layout is in output pixels
+    SDL_Point toPixels(int x, int y) const
+    {
+        return {(int)(x * pixelsPerPointX), (int)(y * pixelsPerPointY)};
+    }
+};
+
+// command line options
+struct Options
+{
+    // redraw on every loop iteration instead of only when the scene changed
+    bool continuous = false;
+    // frame pacing, see FramePacer
+    bool vsync = true;
+    int fpsCap = 0;
+    bool adaptiveVsync = false;
+    // borderless window covering the whole display
+    bool fullscreen = false;
+    // pieces, win line and cat change instantly instead
+    bool animations = true;
+    // render the scripted scenes offscreen instead of opening a window, see runHeadless
+    bool headless = false;
+    const char *dumpDir = nullptr, *goldenDir = nullptr;
+    int benchmarkFrames = 1000;
+    // perf overlay shown from the start, and where the perf log is written (on exit and on F4)
+    bool perfOverlay = false;
+    const char *perfLogPath = nullptr;
+    // Chrome trace-event JSON written on exit
+    const char *tracePath = nullptr;
+    // read the assets directory instead of the copies embedded in the executable, for editing them
+    bool looseAssets = false;
+    // asset pack mapped from disk instead of the embedded one
+    const char *packPath = nullptr;
+    // sleep before decoding each game screen sprite, to see startup on slow storage
+    int assetDelayMs = 0;
+    // count heap allocations per frame and subsystem; allocCheck fails the headless run if a
+    // scene allocates once it is warmed up, allocCheckGameOnly exempts what SDL allocates itself
+    bool allocStats = false, allocCheck = false, allocCheckGameOnly = false;
+
+    void parse(int argc, char *argv[])
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            if (strcmp(argv[i], "--continuous") == 0)
+                continuous = true;
+            else if (strcmp(argv[i], "--vsync") == 0)
+                vsync = true;
+            else if (strcmp(argv[i], "--no-vsync") == 0)
+                vsync = false;
+            else if (strcmp(argv[i], "--adaptive-vsync") == 0)
+                adaptiveVsync = true;
+            else if (strcmp(argv[i], "--fullscreen") == 0)
+                fullscreen = true;
+            else if (strcmp(argv[i], "--no-animations") == 0)
+                animations = false;
+            else if (strcmp(argv[i], "--headless") == 0)
+                headless = true;
+            else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+                dumpDir = argv[++i];
+            else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc)
+                goldenDir = argv[++i];
+            else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+                benchmarkFrames = atoi(argv[++i]);
+            else if (strcmp(argv[i], "--perf-overlay") == 0)
+                perfOverlay = true;
+            else if (strcmp(argv[i], "--perf-log") == 0 && i + 1 < argc)
+                perfLogPath = argv[++i];
+            else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+                tracePath = argv[++i];
+            else if (strcmp(argv[i], "--loose-assets") == 0)
+                looseAssets = true;
+            else if (strcmp(argv[i], "--pack") == 0 && i + 1 < argc)
+                packPath = argv[++i];
+            else if (strcmp(argv[i], "--asset-delay") == 0 && i + 1 < argc)
+                assetDelayMs = atoi(argv[++i]);
+            else if (strcmp(argv[i], "--alloc-stats") == 0)
+                allocStats = true;
+            else if (strcmp(argv[i], "--alloc-check") == 0)
+                allocStats = allocCheck = headless = true;
+            else if (strcmp(argv[i], "--alloc-check-game") == 0)
+                allocStats = allocCheck = allocCheckGameOnly = headless = true;
+            else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+                fpsCap = atoi(argv[++i]);
+            else
+                cerr << "Unknown option: " << argv[i] << endl;
+        }
+    }
+};
+
+// initialize colors
+const SDL_Color BLACK = {0, 0, 0, 255};
+const SDL_Color WHITE = {255, 255, 255, 255};
+
+// how long the render-on-change loop sleeps when no event arrives, and while sprites are
+// still loading in the background
+const int IDLE_WAIT_MS = 1000, LOADING_POLL_MS = 5;
+// animation lengths, and how long the cat waits between idle animations
+const double PIECE_POP_MS = 180, WIN_SWEEP_MS = 350, CAT_IDLE_MS = 1600, CAT_IDLE_INTERVAL_MS = 6000;
+
+// the cat idles by hopping into its other pose for a while and hopping back,
+// progress 1 (not animating) draws the resting pose
+void renderCat(RenderList &list, const TextureAtlas &atlas, const Layout &layout, bool sitting, float progress)
+{
+    const float HOP = 0.2f; // part of the animation each hop takes
+    bool other = progress > HOP && progress < 1 - HOP;
+    bool sit = sitting != other;
+    SDL_Rect rect = sit ? layout.catSit : layout.catStand;
+    float hop = 0;
+    if (progress < HOP)
+        hop = sinf(M_PI * progress / HOP);
+    else if (progress > 1 - HOP && progress < 1)
+        hop = sinf(M_PI * (progress - (1 - HOP)) / HOP);
+    rect.y -= static_cast<int>(hop * rect.h / 8);
+    list.sprite(atlas.get(sit ? SPRITE_CAT_SIT : SPRITE_CAT_STAND), rect);
+}
+
+// what is on screen: the game being played and the widgets showing it, placed by the layout
+struct Scene
+{
+    GameState state = STATE_HOMEPAGE;
+    // initialize the reference board
+    ReferenceBoard refBoard;
+    Player twoPlayer;
+    // initialize the buttons
+    Button onePlayerButton, twoPlayerButton, backButton, playAgainButton;
+    //  initialize the 3x3 board
+    Board mainBoard;
+
+    explicit Scene(const Layout &layout)
+        : onePlayerButton(layout.onePlayerBG, WHITE), twoPlayerButton(layout.twoPlayerBG, WHITE),
+          backButton(layout.backButton, BLACK), playAgainButton(layout.playAgain, BLACK),
+          mainBoard(layout.board.x, layout.board.y, layout.board.w, layout.board.h)
+    {
+    }
+    // moves the widgets after the layout changed
+    void place(const Layout &layout)
+    {
+        onePlayerButton.setRect(layout.onePlayerBG);
+        twoPlayerButton.setRect(layout.twoPlayerBG);
+        backButton.setRect(layout.backButton);
+        playAgainButton.setRect(layout.playAgain);
+        mainBoard.setRect(layout.board);
+    }
+    // puts the side to move on the cell and passes the turn, false if the cell is taken
+    bool play(int row, int col)
+    {
+        if (!refBoard.fillCell(row, col, twoPlayer.player))
+            return false;
+        // check if there is a winner and finds the index and type of win
+        if (refBoard.checkWin(twoPlayer))
+        {
+            twoPlayer.setWinner();
+        }
+        twoPlayer.switchPlayer();
+        return true;
+    }
+    // collects the primitives of the current frame
+    void build(RenderList &list, const TextureAtlas &atlas, const Layout &layout, const Animator &animator)
+    {
+        if (state == STATE_HOMEPAGE)
+        {
+            // render title
+            list.sprite(atlas.get(SPRITE_TITLE), layout.title);
+            // render cat stand img
+            renderCat(list, atlas, layout, false, animator.progress(Animator::CAT_IDLE, 0));
+            // render two player bg
+            list.sprite(atlas.get(SPRITE_TWO_PLAYER_BG), layout.twoPlayerBG);
+            // render one player bg
+            list.sprite(atlas.get(SPRITE_ONE_PLAYER_BG), layout.onePlayerBG);
+            // render game modes buttons
+            onePlayerButton.renderButton(list);
+            twoPlayerButton.renderButton(list);
+        }
+        else if (state == STATE_ONE_GAME)
+        {
+        }
+        else if (state == STATE_TWO_GAME)
+        {
+            // render the 3x3 board
+            mainBoard.renderBoard(list, refBoard.board, twoPlayer, animator);
+            // render back button bg
+            list.sprite(atlas.get(SPRITE_BACK_BUTTON_BG), layout.backButton);
+            backButton.renderButton(list);
+            // render cat sit img
+            renderCat(list, atlas, layout, true, animator.progress(Animator::CAT_IDLE, 0));
+
+            if (refBoard.isFull())
+            {
+                // render the play again button if there is a draw
+                list.sprite(atlas.get(SPRITE_PLAY_AGAIN), layout.playAgain);
+                playAgainButton.renderButton(list);
+                // render cit and coe
+                list.sprite(atlas.get(SPRITE_CIT), layout.cit);
+                list.sprite(atlas.get(SPRITE_COE), layout.coe);
+            }
+            else
+            {
+                if (twoPlayer.winner == '#')
+                {
+                    // if there is no winner render the players depending on their turn
+                    list.sprite(atlas.get(twoPlayer.player == 'o' ? SPRITE_CIT_TURN : SPRITE_CIT), layout.cit);
+                    list.sprite(atlas.get(twoPlayer.player == 'o' ? SPRITE_COE : SPRITE_COE_TURN), layout.coe);
+                }
+                else
+                {
+                    // if there is a winner render the play again button and the win message
+                    list.sprite(atlas.get(SPRITE_PLAY_AGAIN), layout.playAgain);
+                    playAgainButton.renderButton(list);
+                    // render cit or coe win message depending in winner
+                    list.sprite(atlas.get(twoPlayer.winner == 'o' ? SPRITE_CIT_WIN : SPRITE_CIT), layout.cit);
+                    list.sprite(atlas.get(twoPlayer.winner == 'o' ? SPRITE_COE : SPRITE_COE_WIN), layout.coe);
+                }
+            }
+        }
+    }
+};
+
+// 5x7 pixel font for debug text, turned into a small texture once
+class BitmapFont
+{
+public:
+    static const int GLYPH_WIDTH = 5, GLYPH_HEIGHT = 7;
+
+    bool create(SDL_Renderer *renderer)
+    {
+        int count = strlen(CHARACTERS);
+        // one empty column between glyphs
+        SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, count * (GLYPH_WIDTH + 1), GLYPH_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (!surface)
+            return false;
+        SDL_FillRect(surface, nullptr, 0);
+        for (int g = 0; g < count; g++)
+        {
+            for (int y = 0; y < GLYPH_HEIGHT; y++)
+            {
+                Uint32 *row = (Uint32 *)((Uint8 *)surface->pixels + y * surface->pitch) + g * (GLYPH_WIDTH + 1);
+                for (int x = 0; x < GLYPH_WIDTH; x++)
+                {
+                    if (ROWS[g][y] & (0x10 >> x))
+                        row[x] = 0xFFFFFFFF;
+                }
+            }
+        }
+        texture = SDL_CreateTextureFromSurface(renderer, surface);
+        SDL_FreeSurface(surface);
+        if (!texture)
+            return false;
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        SDL_SetTextureScaleMode(texture, SDL_ScaleModeNearest);
+        return true;
+    }
+    void destroy()
+    {
+        if (texture)
+            SDL_DestroyTexture(texture);
+        texture = nullptr;
+    }
+    size_t textureBytes() const
+    {
+        return ::textureBytes(texture);
+    }
+    // draws the text with every font pixel scale pixels big, unknown characters are blank
+    void text(RenderList &list, const char *str, int x, int y, int scale, RenderList::Layer layer) const
+    {
+        for (; *str; str++, x += (GLYPH_WIDTH + 1) * scale)
+        {
+            const char *found = strchr(CHARACTERS, toupper((unsigned char)*str));
+            if (!found || *str == ' ')
+                continue;
+            Sprite glyph = {texture, {(int)(found - CHARACTERS) * (GLYPH_WIDTH + 1), 0, GLYPH_WIDTH, GLYPH_HEIGHT}};
+            list.sprite(glyph, {x, y, GLYPH_WIDTH * scale, GLYPH_HEIGHT * scale}, layer);
+        }
+    }
+
+private:
+    static constexpr const char *CHARACTERS = " .:-/%0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    // one byte per row, the low five bits from left to right
+    static constexpr Uint8 ROWS[][GLYPH_HEIGHT] = {
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // space
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}, // .
+        {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, // :
+        {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}, // -
+        {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // /
+        {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, // %
+        {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, // 0
+        {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 1
+        {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, // 2
+        {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}, // 3
+        {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, // 4
+        {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}, // 5
+        {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, // 6
+        {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 7
+        {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, // 8
+        {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}, // 9
+        {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11}, // A
+        {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}, // B
+        {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}, // C
+        {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}, // D
+        {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}, // E
+        {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}, // F
+        {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}, // G
+        {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // H
+        {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // I
+        {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}, // J
+        {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // K
+        {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, // L
+        {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}, // M
+        {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, // N
+        {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // O
+        {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}, // P
+        {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}, // Q
+        {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}, // R
+        {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}, // S
+        {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // T
+        {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // U
+        {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}, // V
+        {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}, // W
+        {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}, // X
+        {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}, // Y
+        {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}, // Z
+    };
+    SDL_Texture *texture = nullptr;
+};
+
+// video memory held by textures, to keep it flat as sprites are added. The font is left out
+// when it isn't created.
+void reportTextureMemory(ostream &out, const TextureAtlas &atlas, const BitmapFont *font)
+{
+    size_t atlasBytes = atlas.textureBytes(), fontBytes = font ? font->textureBytes() : 0;
+    out << "Texture memory: " << (atlasBytes + fontBytes) / 1024 << " KiB (" << atlas.pageCount() << " atlas pages "
+        << atlasBytes / 1024 << " KiB";
+    if (font)
+        out << ", font " << fontBytes / 1024 << " KiB";
+    out << ")" << endl;
+    out << "Atlas upload: " << atlas.uploadTime() << " ms, pixel conversion " << atlas.conversionTime() << " ms ("
+        << atlas.convertedSpriteCount() << " sprites)" << endl;
+}
+
+// frames averaged for the overlay numbers, and frames shown in its graph
+const int OVERLAY_AVERAGE_FRAMES = 60, OVERLAY_GRAPH_FRAMES = 120;
+
+// FPS, the average time of every phase, click latency percentiles and a graph of recent
+// frame times, in the top right corner, plus the allocations of the last frame when they
+// are counted. Frame times are the work of a frame, the FPS is the rate of presents, which
+// is real because the loop redraws continuously while the overlay is shown. Builds a few
+// dozen commands: the panel and bars are one geometry run, the text another.
+void renderPerfOverlay(RenderList &list, const BitmapFont &font, const PerfLog &perf, const InputLatency &latency,
+                       const AllocStats::Counts *frameAllocations, int outputWidth)
+{
+    const int SCALE = 2, LINE = (BitmapFont::GLYPH_HEIGHT + 2) * SCALE, GRAPH_HEIGHT = 40;
+    // the graph tops out at two 60 Hz frames
+    const double GRAPH_MAX_MS = 33.3;
+    const RenderList::Layer layer = RenderList::LAYER_DEBUG;
+    int width = OVERLAY_GRAPH_FRAMES * 2 + 8;
+    int lines = PerfLog::PHASE_COUNT + 2 + (frameAllocations ? 1 : 0);
+    int height = lines * LINE + GRAPH_HEIGHT + 12;
+    SDL_Rect panel = {outputWidth - width - 8, 8, width, height};
+    list.fillRect(panel, {0, 0, 0, 190}, layer);
+
+    int x = panel.x + 4, y = panel.y + 4;
+    char line[48];
+    double intervalMs = perf.averageIntervalMs(OVERLAY_AVERAGE_FRAMES);
+    snprintf(line, sizeof(line), "FPS %5.1f %7.2f MS", intervalMs > 0 ? 1000.0 / intervalMs : 0.0, perf.averageFrameMs(OVERLAY_AVERAGE_FRAMES));
+    font.text(list, line, x, y, SCALE, layer);
+    for (int p = 0; p < PerfLog::PHASE_COUNT; p++)
+    {
+        y += LINE;
+        snprintf(line, sizeof(line), "%-8s %6.3f MS", PerfLog::phaseName(p), perf.averagePhaseMs(p, OVERLAY_AVERAGE_FRAMES));
+        font.text(list, line, x, y, SCALE, layer);
+    }
+    y += LINE;
+    snprintf(line, sizeof(line), "LAT P50 %3d P99 %3d", latency.percentile(50), latency.percentile(99));
+    font.text(list, line, x, y, SCALE, layer);
+    if (frameAllocations)
+    {
+        y += LINE;
+        snprintf(line, sizeof(line), "ALLOC %5llu %7lluB", (unsigned long long)frameAllocations->totalAllocations(),
+                 (unsigned long long)frameAllocations->totalBytes());
+        font.text(list, line, x, y, SCALE, layer);
+    }
+
+    // newest frame on the right, green within one 60 Hz frame, yellow within two, red beyond
+    int bottom = panel.y + panel.h - 4;
+    for (int age = 0; age < OVERLAY_GRAPH_FRAMES && age < perf.count(); age++)
+    {
+        double ms = perf.frameMs(age);
+        int bar = max(1, (int)(min(ms, GRAPH_MAX_MS) / GRAPH_MAX_MS * GRAPH_HEIGHT));
+        SDL_Color color = ms <= 16.7 ? SDL_Color{80, 220, 80, 255} : (ms <= 33.3 ? SDL_Color{230, 200, 60, 255} : SDL_Color{230, 70, 60, 255});
+        int bx = panel.x + panel.w - 4 - (age + 1) * 2;
+        list.fillRect({bx, bottom - bar, 2, bar}, color, layer);
+    }
+}
+
+// allocation counts and bytes in total and per subsystem, averaged over frames if given
+void reportAllocations(ostream &out, const char *what, const AllocStats::Counts &counts, long long frames = 0)
+{
+    double divisor = frames > 0 ? (double)frames : 1.0;
+    out << what << ": " << counts.totalAllocations() / divisor << " allocations, " << (long long)(counts.totalBytes() / divisor + 0.5) << " bytes"
+        << (frames > 0 ? " per frame (" : " (");
+    for (int s = 0; s < AllocStats::ALLOC_SUBSYSTEMS; s++)
+        out << (s ? ", " : "") << AllocStats::name(s) << " " << counts.allocations[s] / divisor;
+    out << "), " << counts.sdlAllocations / divisor << " of them inside SDL" << endl;
+}
+
+// a game state to render headless, reached by playing the moves (cell digits) from an empty board
+struct HeadlessScript
+{
+    const char *name;
+    GameState state;
+    const char *moves;
+};
+const HeadlessScript HEADLESS_SCRIPTS[] = {
+    {"homepage", STATE_HOMEPAGE, ""},
+    {"twoplayer", STATE_TWO_GAME, "031"},
+    {"win", STATE_TWO_GAME, "03142"},
+    {"draw", STATE_TWO_GAME, "012435768"},
+};
+
+// pixels that differ between two surfaces of the same size, -1 if the sizes differ
+long long countDifferences(SDL_Surface *frame, SDL_Surface *golden)
+{
+    if (frame->w != golden->w || frame->h != golden->h)
+        return -1;
+    SDL_Surface *converted = SDL_ConvertSurfaceFormat(golden, frame->format->format, 0);
+    if (!converted)
+        return -1;
+    long long differences = 0;
+    for (int y = 0; y < frame->h; y++)
+    {
+        const Uint32 *a = (const Uint32 *)((const Uint8 *)frame->pixels + y * frame->pitch);
+        const Uint32 *b = (const Uint32 *)((const Uint8 *)converted->pixels + y * converted->pitch);
+        for (int x = 0; x < frame->w; x++)
+        {
+            // alpha of the target is meaningless, the window has none
+            if ((a[x] ^ b[x]) & 0x00FFFFFF)
+                differences++;
+        }
+    }
+    SDL_FreeSurface(converted);
+    return differences;
+}
+
+// frames of each scene that must not allocate for --alloc-check to pass
+const int ALLOC_CHECK_FRAMES = 100;
+
+// renders every HEADLESS_SCRIPTS scene through the same path as the window into the
+// offscreen target, optionally saving each frame to dumpDir and comparing it with the
+// frame of the same name in goldenDir, then times benchmarkFrames frames of each.
+// Returns 1 if any frame differs from its golden image, or allocates with allocCheck.
+int runHeadless(const Options &options, SDL_Renderer *renderer, SDL_Surface *target, const TextureAtlas &atlas, const Layout &layout)
+{
+    // scenes are rendered as they look at rest
+    Animator still;
+    still.setEnabled(false);
+    RenderList list;
+    PrimitiveBatch batch;
+    int failures = 0, allocationFailures = 0;
+    for (const HeadlessScript &script : HEADLESS_SCRIPTS)
+    {
+        Scene scene(layout);
+        scene.state = script.state;
+        for (const char *move = script.moves; *move; move++)
+            scene.play((*move - '0') / 3, (*move - '0') % 3);
+
+        auto renderFrame = [&]()
+        {
+            TRACE_SCOPE("headless frame");
+            SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xFF);
+            SDL_RenderClear(renderer);
+            scene.build(list, atlas, layout, still);
+            list.submit(batch, renderer);
+            SDL_RenderPresent(renderer);
+        };
+        renderFrame();
+        string file = string(script.name) + ".bmp";
+        if (options.dumpDir)
+        {
+            string path = string(options.dumpDir) + "/" + file;
+            if (SDL_SaveBMP(target, path.c_str()) != 0)
+                cerr << "Unable to save frame: " << path << "! SDL_Error: " << SDL_GetError() << endl;
+        }
+        if (options.goldenDir)
+        {
+            string path = string(options.goldenDir) + "/" + file;
+            SDL_Surface *golden = loadSurface(path.c_str());
+            long long differences = golden ? countDifferences(target, golden) : -1;
+            if (golden)
+                SDL_FreeSurface(golden);
+            if (differences != 0)
+            {
+                failures++;
+                cerr << script.name << ": " << (differences < 0 ? "no matching golden image" : to_string(differences) + " pixels differ") << endl;
+            }
+        }
+
+        if (options.allocCheck)
+        {
+            // the first frame sized every buffer, anything allocated from here on is allocated every
+            // frame. SDL's own allocations count too unless only the game's are checked.
+            AllocStats::Counts start = AllocStats::snapshot();
+            for (int i = 0; i < ALLOC_CHECK_FRAMES; i++)
+                renderFrame();
+            AllocStats::Counts steady = AllocStats::snapshot().since(start);
+            uint64_t exempt = options.allocCheckGameOnly ? steady.sdlAllocations : 0;
+            if (steady.totalAllocations() > exempt)
+                allocationFailures++;
+            if (steady.totalAllocations() > 0)
+                reportAllocations(cerr, script.name, steady, ALLOC_CHECK_FRAMES);
+        }
+
+        if (options.benchmarkFrames > 0)
+        {
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (int i = 0; i < options.benchmarkFrames; i++)
+                renderFrame();
+            double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+            cout << script.name << ": " << options.benchmarkFrames << " frames in " << ms << " ms, "
+                 << ms / options.benchmarkFrames << " ms per frame, " << options.benchmarkFrames * 1000.0 / ms << " fps" << endl;
+        }
+        batch.takeDrawCalls();
+    }
+    if (options.goldenDir)
+        cout << (failures ? "Golden image check failed" : "Golden image check passed") << endl;
+    if (options.allocCheck)
+        cout << (allocationFailures ? "Allocation check failed" : "Allocation check passed")
+             << (options.allocCheckGameOnly ? " (allocations inside SDL exempt)" : "") << endl;
+    return failures || allocationFailures ? 1 : 0;
+}
+
+void writeTrace(const Options &options)
+{
+    if (!options.tracePath)
+        return;
+    if (Trace::write(options.tracePath))
+        cout << "Trace written to " << options.tracePath << endl;
+    else
+        cerr << "Unable to write the trace: " << options.tracePath << endl;
+}
+
 int main(int argc, char *argv[])
 {
+    // startup is timed from here, the high resolution counter works before SDL_Init
+    double launchedMs = clockMs();
+    Options options;
+    options.parse(argc, argv);
+    if (options.tracePath)
+        Trace::start();
+    if (options.allocStats)
+    {
+        countSDLAllocations();
+        AllocStats::enable();
+    }
+
+    // render at the real pixel density instead of letting Windows scale the window up
+    SDL_SetHint(SDL_HINT_WINDOWS_DPI_AWARENESS, "permonitorv2");
+    // headless runs need no display
+    if (options.headless)
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
     // initialize SDL
-    if (SDL_Init(SDL_INIT_VIDEO) < 0)
+    bool initialized;
+    {
+        TRACE_SCOPE("SDL_Init");
+        initialized = SDL_Init(SDL_INIT_VIDEO) == 0;
+    }
+    if (!initialized)
     {
         cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << endl;
         return -1;
     }
-    // create window
-    SDL_Window *window = SDL_CreateWindow("Cit Cat Coe", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-    if (!window)
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    // headless frames are drawn by the software renderer straight into this surface
+    SDL_Surface *offscreen = nullptr;
+    if (options.headless)
     {
-        cerr << "Window could not be created! SDL_Error: " << SDL_GetError() << endl;
-        SDL_Quit();
-        return -1;
+        offscreen = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (!offscreen)
+        {
+            cerr << "Offscreen surface could not be created! SDL_Error: " << SDL_GetError() << endl;
+            SDL_Quit();
+            return -1;
+        }
+        renderer = SDL_CreateSoftwareRenderer(offscreen);
+    }
+    else
+    {
+        // create window
+        Uint32 windowFlags = SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI | (options.fullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0);
+        window = SDL_CreateWindow("Cit Cat Coe", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, windowFlags);
+        if (!window)
+        {
+            cerr << "Window could not be created! SDL_Error: " << SDL_GetError() << endl;
+            SDL_Quit();
+            return -1;
+        }
+        // create renderer
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | (options.vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
     }
-    // create renderer
-    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
     if (!renderer)
     {
         cerr << "Renderer could not be created! SDL_Error: " << SDL_GetError() << endl;
-        SDL_DestroyWindow(window);
+        if (window)
+            SDL_DestroyWindow(window);
+        if (offscreen)
+            SDL_FreeSurface(offscreen);
         SDL_Quit();
         return -1;
     }
-    // load the icon
-    SDL_Surface *icon = SDL_LoadBMP("icon.bmp");
-    if (icon)
-    {
-        SDL_SetWindowIcon(window, icon);
-        SDL_FreeSurface(icon);
-    }
-    // initialize a hash map for textures
-    map<string, SDL_Texture *> textures;
-    // load title
-    SDL_Rect title_Rect = {(SCREEN_WIDTH - 582) / 2, 90, 582, 96};
-    textures["title"] = loadImage(renderer, "assets/title.bmp");
-
-    // load cat_stand image
-    SDL_Rect cat_stand_Rect = {600, 450, 140, 100};
-    textures["cat_stand"] = loadImage(renderer, "assets/cat_stand.bmp");
-    // load cat2 image
-    SDL_Rect cat_sit_Rect = {600, 450, 110, 110};
-    textures["cat_sit"] = loadImage(renderer, "assets/cat_sit.bmp");
-
-    // load twoplayer background
-    SDL_Rect twoPlayer_BG_Rect = {SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 + 60, 200, 80};
-    textures["twoPlayer_BG"] = loadImage(renderer, "assets/twoplayer.bmp");
-    // load one player background
-    SDL_Rect onePlayer_BG_Rect = {SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 - 50, 200, 80};
-    textures["onePlayer_BG_Rect"] = loadImage(renderer, "assets/twoplayer.bmp");
-
-    // load back button background
-    SDL_Rect backButton_BG_Rect = {20, 20, 40, 40};
-    textures["backButton_BG"] = loadImage(renderer, "assets/back.bmp");
-
-    // load again image
-    SDL_Rect playAgain_Rect = {370, 490, 60, 60};
-    textures["playAgain"] = loadImage(renderer, "assets/playAgain.bmp");
-
-    // load cit image
-    SDL_Rect cit_Rect = {40, 250, 180, 90};
-    textures["cit"] = loadImage(renderer, "assets/cit.bmp");
-    // load cit_turn image
-    textures["cit_turn"] = loadImage(renderer, "assets/cit_turn.bmp");
-    // load cit_win image
-    textures["cit_win"] = loadImage(renderer, "assets/cit_win.bmp");
-
-    // load coe image
-    SDL_Rect coe_Rect = {570, 255, 180, 90};
-    textures["coe"] = loadImage(renderer, "assets/coe.bmp");
-    // load coe_turn image
-    textures["coe_turn"] = loadImage(renderer, "assets/coe_turn.bmp");
-    // load coe_win image
-    textures["coe_win"] = loadImage(renderer, "assets/coe_win.bmp");
-
-    // error check for all the immages turned into textures
-    for (auto &pair : textures)
-    {
-        if (!pair.second)
-        {
-            cerr << "Error: Failed to load texture '" << pair.first << "'!" << endl;
-            cleanup(window, renderer, textures);
-            return -1;
+    // sprites are decoded on worker threads while the renderer starts up, only the upload
+    // into atlas textures happens here
+    AssetLoader::Decoder decoder = loadSurface;
+    // the pack given, or else the one embedded in the executable
+    AssetPack pack;
+    if (!options.looseAssets)
+    {
+        if (options.packPath)
+            pack.openFile(options.packPath);
+        else if (const EmbeddedAsset *embedded = findEmbeddedAsset(EMBEDDED_PACK))
+            pack.openMemory(embedded->data, embedded->size, EMBEDDED_PACK);
+        decoder = [&pack](const char *path)
+        { return loadPackedSurface(pack, path); };
+    }
+    if (options.assetDelayMs > 0)
+    {
+        decoder = [inner = decoder, delayMs = options.assetDelayMs](const char *path)
+        {
+            if (filePage(path) == PAGE_GAME)
+                SDL_Delay(delayMs);
+            return inner(path);
+        };
+    }
+    AssetLoader loader;
+    loader.start(SPRITE_FILES, SPRITE_COUNT, decoder);
+    TextureAtlas atlas;
+    {
+        AllocStats::Scope allocScope(AllocStats::ALLOC_ASSETS);
+        // load the icon
+        SDL_Surface *icon = window ? decoder("assets/icon.bmp") : nullptr;
+        if (icon)
+        {
+            SDL_SetWindowIcon(window, icon);
+            SDL_FreeSurface(icon);
         }
     }
+    // the homepage shows as soon as its sprites are in, the game screens' follow in the
+    // background (headless runs need everything up front)
+    bool gameLoaded = false;
+    bool built = buildPage(atlas, loader, PAGE_HOMEPAGE, renderer);
+    double homepageReadyMs = clockMs() - launchedMs;
+    if (built && options.headless)
+        built = gameLoaded = buildPage(atlas, loader, PAGE_GAME, renderer);
+    if (!built)
+    {
+        cleanup(window, renderer, atlas, loader);
+        if (offscreen)
+            SDL_FreeSurface(offscreen);
+        return -1;
+    }
 
-    // initialize colors
-    SDL_Color black = {0, 0, 0, 255};
-    SDL_Color white = {255, 255, 255, 255};
+    // rects of the current window size
+    Layout layout;
+    layout.update(window, renderer);
+    // the atlas padding keeps linear filtering inside each sprite
+    atlas.setScaleMode(layout.unscaled() ? SDL_ScaleModeNearest : SDL_ScaleModeLinear);
 
-    // initialize the buttons
-    Button onePlayerButton(onePlayer_BG_Rect, white);
-    Button twoPlayerButton(twoPlayer_BG_Rect, white);
-    Button backButton(backButton_BG_Rect, black);
-    Button playAgainButton(playAgain_Rect, black);
-    //  initialize the 3x3 board
-    Board mainBoard((SCREEN_WIDTH - 300) / 2, (SCREEN_HEIGHT - 300) / 2, 300, 300);
-    // initialize the reference board
-    ReferenceBoard refBoard;
-    Player twoPlayer;
+    Scene scene(layout);
+
+    // glyph meshes fade out through vertex alpha
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    if (options.headless)
+    {
+        AllocStats::Scope allocScope(AllocStats::ALLOC_RENDER);
+        reportTextureMemory(cout, atlas, nullptr);
+        int result = runHeadless(options, renderer, offscreen, atlas, layout);
+        cleanup(window, renderer, atlas, loader);
+        SDL_FreeSurface(offscreen);
+        writeTrace(options);
+        return result;
+    }
+
+    FramePacer pacer;
+    pacer.configure(window, renderer, options.vsync, options.fpsCap, options.adaptiveVsync);
+    // commands and primitives of the current frame, draw call and stage statistics
+    RenderList list;
+    PrimitiveBatch batch;
+    long long frames = 0, totalDrawCalls = 0;
+    int maxDrawCalls = 0;
+    double buildMs = 0, submitMs = 0;
+    // per-phase timing, shown by the overlay (F3) and written to the perf log (F4 and on exit)
+    PerfLog perf;
+    // from the click placing a piece to the first present showing it
+    InputLatency latency;
+    BitmapFont font;
+    {
+        AllocStats::Scope allocScope(AllocStats::ALLOC_ASSETS);
+        if (!font.create(renderer))
+            cerr << "Unable to create the overlay font! SDL_Error: " << SDL_GetError() << endl;
+    }
+    bool showOverlay = options.perfOverlay;
+    const char *perfLogPath = options.perfLogPath ? options.perfLogPath : "perf.csv";
+    double overlayMs = 0;
+    long long overlayFrames = 0;
+    // allocations from the end of one presented frame to the next, with --alloc-stats
+    AllocStats::Counts startupAllocations = AllocStats::snapshot(), frameStart = startupAllocations;
+    AllocStats::Counts lastFrameAllocations, totalFrameAllocations;
+    long long allocatingFrames = 0;
 
-    GameState currentState = STATE_HOMEPAGE;
     bool quit = false;
+    int result = 0;
+    // set whenever what is on screen would change, only dirty frames get presented
+    bool dirty = true;
+    // animation state, the loop only runs without sleeping while something animates
+    Animator animator;
+    animator.setEnabled(options.animations);
+    double nextCatIdle = clockMs() + CAT_IDLE_INTERVAL_MS;
+    // cell of the last piece placed until it first shows, for the click latency
+    int poppingCell = -1;
     SDL_Event e;
     while (!quit)
     {
-        while (SDL_PollEvent(&e) != 0)
+        // waiting and events count as input, the rest of the frame as rendering
+        AllocStats::Scope inputScope(AllocStats::ALLOC_INPUT);
+        // sleep until something happens or the cat is due to move, unless animating or redrawing continuously
+        int waitMs = IDLE_WAIT_MS;
+        if (animator.isEnabled())
+            waitMs = max(0, min(IDLE_WAIT_MS, static_cast<int>(nextCatIdle - clockMs()) + 1));
+        // check back on the sprites still loading in the background
+        if (!gameLoaded)
+            waitMs = min(waitMs, LOADING_POLL_MS);
+        bool hasEvent;
+        // the perf overlay keeps redrawing so its numbers stay live
+        bool polling = options.continuous || animator.active() || showOverlay;
+        {
+            TRACE_SCOPE("wait");
+            hasEvent = polling ? SDL_PollEvent(&e) : SDL_WaitEventTimeout(&e, waitMs);
+        }
+        pacer.frameStarted(!polling);
+        perf.beginFrame();
+        perf.begin(PerfLog::PHASE_EVENTS);
+        for (; hasEvent; hasEvent = SDL_PollEvent(&e))
         {
             if (e.type == SDL_QUIT)
             {
                 quit = true;
             }
+            else if (e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET)
+            {
+                // what was presented may be lost
+                dirty = true;
+            }
+            else if (e.type == SDL_WINDOWEVENT)
+            {
+                // everything is placed again only when the size actually changed
+                if (e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED && layout.update(window, renderer))
+                {
+                    scene.place(layout);
+                    atlas.setScaleMode(layout.unscaled() ? SDL_ScaleModeNearest : SDL_ScaleModeLinear);
+                }
+                // the window contents may have been lost or resized
+                if (e.window.event == SDL_WINDOWEVENT_EXPOSED || e.window.event == SDL_WINDOWEVENT_SHOWN ||
+                    e.window.event == SDL_WINDOWEVENT_RESTORED || e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                    dirty = true;
+            }
+            else if (e.type == SDL_KEYDOWN && !e.key.repeat)
+            {
+                if (e.key.keysym.sym == SDLK_F3)
+                {
+                    showOverlay = !showOverlay;
+                    dirty = true;
+                }
+                else if (e.key.keysym.sym == SDLK_F4)
+                {
+                    if (perf.write(perfLogPath))
+                        cout << "Perf log written to " << perfLogPath << endl;
+                    else
+                        cerr << "Unable to write the perf log: " << perfLogPath << endl;
+                }
+            }
             else if (e.type == SDL_MOUSEBUTTONDOWN)
             {
-                int mouseX = e.button.x;
-                int mouseY = e.button.y;
+                // the cat only idles while nobody is playing
+                nextCatIdle = clockMs() + CAT_IDLE_INTERVAL_MS;
+                SDL_Point mouse = layout.toPixels(e.button.x, e.button.y);
+                int mouseX = mouse.x;
+                int mouseY = mouse.y;
 
-                if ((currentState == STATE_ONE_GAME || currentState == STATE_TWO_GAME))
+                if ((scene.state == STATE_ONE_GAME || scene.state == STATE_TWO_GAME))
                 {
                     // reset reffrence board and player order if play again or back button button pressed
-                    if (playAgainButton.isClicked(mouseX, mouseY) || backButton.isClicked(mouseX, mouseY))
+                    if (scene.playAgainButton.isClicked(mouseX, mouseY) || scene.backButton.isClicked(mouseX, mouseY))
                     {
-                        refBoard.reset('-');
-                        twoPlayer.reset();
+                        scene.refBoard.reset('-');
+                        scene.twoPlayer.reset();
+                        animator.cancel(Animator::PIECE_POP);
+                        animator.cancel(Animator::WIN_SWEEP);
+                        dirty = true;
                         // if back button pressed chang state to homepaage
-                        if (backButton.isClicked(mouseX, mouseY))
+                        if (scene.backButton.isClicked(mouseX, mouseY))
                         {
-                            currentState = STATE_HOMEPAGE;
+                            scene.state = STATE_HOMEPAGE;
                         }
                     }
-                    if (mainBoard.isClicked(mouseX, mouseY) && twoPlayer.winner == '#')
+                    if (scene.mainBoard.isClicked(mouseX, mouseY) && scene.twoPlayer.winner == '#')
                     {
                         int row, col;
-                        mainBoard.findCell(mouseX, mouseY, row, col);
-                        if (refBoard.fillCell(row, col, twoPlayer.player))
+                        scene.mainBoard.findCell(mouseX, mouseY, row, col);
+                        if (scene.play(row, col))
                         {
-                            // check if there is a winner and finds the index and type of win
-                            if (refBoard.checkWin(twoPlayer))
-                            {
-                                twoPlayer.setWinner();
-                            }
-                            twoPlayer.switchPlayer();
+                            latency.handled(e.button.timestamp);
+                            poppingCell = row * 3 + col;
+                            animator.start(Animator::PIECE_POP, poppingCell, PIECE_POP_MS);
+                            // the line sweeps once the last piece is in
+                            if (scene.twoPlayer.winner != '#')
+                                animator.start(Animator::WIN_SWEEP, 0, WIN_SWEEP_MS, PIECE_POP_MS);
+                            dirty = true;
                         }
                     }
                 }
-                if (currentState == STATE_HOMEPAGE)
+                if (scene.state == STATE_HOMEPAGE)
                 {
-                    if (onePlayerButton.isClicked(mouseX, mouseY))
-                        currentState = STATE_ONE_GAME;
-                    if (twoPlayerButton.isClicked(mouseX, mouseY))
-                        currentState = STATE_TWO_GAME;
+                    if (scene.onePlayerButton.isClicked(mouseX, mouseY))
+                        scene.state = STATE_ONE_GAME;
+                    if (scene.twoPlayerButton.isClicked(mouseX, mouseY))
+                        scene.state = STATE_TWO_GAME;
+                    dirty = dirty || scene.state != STATE_HOMEPAGE;
                 }
             }
         }
+        perf.end(PerfLog::PHASE_EVENTS);
+
+        AllocStats::Scope renderScope(AllocStats::ALLOC_RENDER);
+        perf.begin(PerfLog::PHASE_UPDATE);
+        // upload the game screens' sprites once decoded, or right away once they are needed
+        if (!gameLoaded && (scene.state != STATE_HOMEPAGE || pageDecoded(loader, PAGE_GAME)))
+        {
+            if (!buildPage(atlas, loader, PAGE_GAME, renderer))
+            {
+                result = -1;
+                break;
+            }
+            gameLoaded = true;
+            cout << "All sprites loaded after " << clockMs() - launchedMs << " ms, " << SPRITE_COUNT << " sprites from "
+                 << loader.uniqueCount() << " images" << endl;
+            reportTextureMemory(cout, atlas, &font);
+        }
+        double now = clockMs();
+        if (animator.isEnabled() && now >= nextCatIdle)
+        {
+            animator.start(Animator::CAT_IDLE, 0, CAT_IDLE_MS);
+            nextCatIdle = now + CAT_IDLE_MS + CAT_IDLE_INTERVAL_MS;
+        }
+        if (animator.update(now))
+            dirty = true;
+        perf.end(PerfLog::PHASE_UPDATE);
+        if (!dirty && !polling)
+            continue;
+        dirty = false;
+
         SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xFF);
         SDL_RenderClear(renderer);
 
-        if (currentState == STATE_HOMEPAGE)
+        perf.begin(PerfLog::PHASE_BUILD);
+        scene.build(list, atlas, layout, animator);
+        if (showOverlay)
         {
-            // render title
-            SDL_RenderCopy(renderer, textures["title"], nullptr, &title_Rect);
-            // render cat stand img
-            SDL_RenderCopy(renderer, textures["cat_stand"], nullptr, &cat_stand_Rect);
-            // render two player bg
-            SDL_RenderCopy(renderer, textures["twoPlayer_BG"], nullptr, &twoPlayer_BG_Rect);
-            // render one player bg
-            SDL_RenderCopy(renderer, textures["onePlayer_BG"], nullptr, &onePlayer_BG_Rect);
-            // render game modes buttons
-            onePlayerButton.renderButton(renderer);
-            twoPlayerButton.renderButton(renderer);
+            double overlayStart = clockMs();
+            renderPerfOverlay(list, font, perf, latency, options.allocStats ? &lastFrameAllocations : nullptr, layout.width());
+            overlayMs += clockMs() - overlayStart;
+            overlayFrames++;
         }
-        else if (currentState == STATE_ONE_GAME)
+        perf.end(PerfLog::PHASE_BUILD);
+        perf.begin(PerfLog::PHASE_SUBMIT);
+        list.submit(batch, renderer);
+        perf.end(PerfLog::PHASE_SUBMIT);
+        int drawCalls = batch.takeDrawCalls();
+        frames++;
+        totalDrawCalls += drawCalls;
+        maxDrawCalls = max(maxDrawCalls, drawCalls);
+        pacer.waitForSlot();
+        perf.begin(PerfLog::PHASE_PRESENT);
+        SDL_RenderPresent(renderer);
+        perf.end(PerfLog::PHASE_PRESENT);
+        pacer.framePresented();
+        perf.framePresented();
+        // a pop starts at scale 0, the click only shows once the piece is drawn at all
+        if (poppingCell < 0 || animator.progress(Animator::PIECE_POP, poppingCell) > 0)
         {
+            latency.framePresented();
+            poppingCell = -1;
         }
-        else if (currentState == STATE_TWO_GAME)
+        if (frames == 1)
+            cout << "First frame presented after " << clockMs() - launchedMs << " ms (homepage sprites loaded after "
+                 << homepageReadyMs << " ms)" << endl;
+        buildMs += perf.phaseMs(0, PerfLog::PHASE_BUILD);
+        submitMs += perf.phaseMs(0, PerfLog::PHASE_SUBMIT);
+        if (options.allocStats)
         {
-            // render the 3x3 board
-            mainBoard.renderBoard(renderer, refBoard.board, twoPlayer);
-            // render back button bg
-            SDL_RenderCopy(renderer, textures["backButton_BG"], nullptr, &backButton_BG_Rect);
-            backButton.renderButton(renderer);
-            // render cat sit img
-            SDL_RenderCopy(renderer, textures["cat_sit"], nullptr, &cat_sit_Rect);
-
-            if (refBoard.isFull())
-            {
-                // render the play again button if there is a draw
-                SDL_RenderCopy(renderer, textures["playAgain"], nullptr, &playAgain_Rect);
-                playAgainButton.renderButton(renderer);
-                // render cit and coe
-                SDL_RenderCopy(renderer, textures["cit"], nullptr, &cit_Rect);
-                SDL_RenderCopy(renderer, textures["coe"], nullptr, &coe_Rect);
-            }
-            else
-            {
-                if (twoPlayer.winner == '#')
-                {
-                    // if there is no winner render the players depending on their turn
-                    SDL_RenderCopy(renderer, textures[twoPlayer.player == 'o' ? "cit_turn" : "cit"], nullptr, &cit_Rect);
-                    SDL_RenderCopy(renderer, textures[twoPlayer.player == 'o' ? "coe" : "coe_turn"], nullptr, &coe_Rect);
-                }
-                else
-                {
-                    // if there is a winner render the play again button and the win message
-                    SDL_RenderCopy(renderer, textures["playAgain"], nullptr, &playAgain_Rect);
-                    playAgainButton.renderButton(renderer);
-                    // render cit or coe win message depending in winner
-                    SDL_RenderCopy(renderer, textures[twoPlayer.winner == 'o' ? "cit_win" : "cit"], nullptr, &cit_Rect);
-                    SDL_RenderCopy(renderer, textures[twoPlayer.winner == 'o' ? "coe" : "coe_win"], nullptr, &coe_Rect);
-                }
-            }
+            AllocStats::Counts counted = AllocStats::snapshot();
+            lastFrameAllocations = counted.since(frameStart);
+            frameStart = counted;
+            totalFrameAllocations.add(lastFrameAllocations);
+            if (lastFrameAllocations.totalAllocations() > 0)
+                allocatingFrames++;
+        }
+    }
+    if (frames > 0)
+    {
+        cout << "Draw calls per frame: average " << (double)totalDrawCalls / frames << ", max " << maxDrawCalls << endl;
+        cout << "Scene build " << buildMs / frames << " ms, submit " << submitMs / frames << " ms per frame" << endl;
+    }
+    if (overlayFrames > 0)
+        cout << "Perf overlay " << overlayMs / overlayFrames << " ms per frame" << endl;
+    if (options.allocStats)
+    {
+        reportAllocations(cout, "Startup", startupAllocations);
+        if (frames > 0)
+        {
+            reportAllocations(cout, "Frames", totalFrameAllocations, frames);
+            cout << allocatingFrames << " of " << frames << " frames allocated" << endl;
         }
-        SDL_RenderPresent(renderer);
     }
-    cleanup(window, renderer, textures);
-    return 0;
+    if (options.perfLogPath && !perf.write(options.perfLogPath))
+        cerr << "Unable to write the perf log: " << options.perfLogPath << endl;
+    pacer.report(cout);
+    latency.report(cout);
+    font.destroy();
+    cleanup(window, renderer, atlas, loader);
+    writeTrace(options);
+    return result;
 }
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef EMBEDDED_ASSETS_H
+#define EMBEDDED_ASSETS_H
+
+#include <cstddef>
+#include <cstring>
+
+// Asset files compiled into the executable as constant byte arrays. The table is generated
+// by tools/EmbedAssets (make embed) into EmbeddedAssets.cpp, which has to be linked in.
+struct EmbeddedAsset
+{
+    const char *path; // as given to the generator, e.g. "assets.pack"
+    const unsigned char *data;
+    size_t size;
+};
+
+extern const EmbeddedAsset EMBEDDED_ASSETS[];
+extern const int EMBEDDED_ASSET_COUNT;
+
+// the embedded copy of a file, null if it wasn't embedded
+inline const EmbeddedAsset *findEmbeddedAsset(const char *path)
+{
+    for (int i = 0; i < EMBEDDED_ASSET_COUNT; i++)
+    {
+        if (strcmp(EMBEDDED_ASSETS[i].path, path) == 0)
+            return &EMBEDDED_ASSETS[i];
+    }
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <iostream>
+
+// Paces presented frames: optional vsync, an optional FPS cap that sleeps most of the wait
+// and spins the last stretch for precision, and a fallback that turns vsync off and caps at
+// the refresh rate when frames keep missing vblanks (so a slow frame tears instead of
+// waiting a whole extra refresh). Keeps a rolling window of frame times for percentiles,
+// each from the end of the loop's wait for events to the present, so the time the
+// render-on-change loop sits idle between inputs never counts as a frame.
+class FramePacer
+{
+public:
+    // frames kept for the percentiles
+    static const int HISTORY = 240;
+
+    void configure(SDL_Window *targetWindow, SDL_Renderer *targetRenderer, bool useVsync, int fpsCap, bool useAdaptive)
+    {
+        window = targetWindow;
+        renderer = targetRenderer;
+        vsync = useVsync;
+        adaptive = useAdaptive;
+        setCap(fpsCap);
+        frequency = SDL_GetPerformanceFrequency();
+    }
+    void setCap(int fps)
+    {
+        cap = fps > 0 ? fps : 0;
+    }
+
+    // call right before SDL_RenderPresent, waits until the next frame slot of the cap
+    void waitForSlot()
+    {
+        if (cap == 0 || lastPresent == 0)
+            return;
+        Uint64 deadline = lastPresent + frequency / cap;
+        Uint64 now = SDL_GetPerformanceCounter();
+        // SDL_Delay may oversleep by a millisecond or two, so stop sleeping early and spin
+        const Uint64 spinTicks = frequency * 2 / 1000;
+        while (now + spinTicks < deadline)
+        {
+            Uint32 sleepMs = static_cast<Uint32>((deadline - now - spinTicks) * 1000 / frequency);
+            SDL_Delay(sleepMs > 0 ? sleepMs : 1);
+            now = SDL_GetPerformanceCounter();
+        }
+        while (now < deadline)
+            now = SDL_GetPerformanceCounter();
+    }
+
+    // call once the loop stops waiting for events, a frame presented later starts here.
+    // waited is whether the loop blocked for events rather than polled.
+    void frameStarted(bool waited)
+    {
+        frameStart = SDL_GetPerformanceCounter();
+        if (waited)
+            backToBack = false;
+    }
+    // call right after SDL_RenderPresent
+    void framePresented()
+    {
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (frameStart != 0)
+        {
+            times[next] = static_cast<float>((now - frameStart) * 1000.0 / frequency);
+            next = (next + 1) % HISTORY;
+            recorded++;
+        }
+        // only presents with no wait in between (continuous or animating) tell whether
+        // vblanks are missed, the time around a wait is idle
+        if (backToBack && vsync && adaptive)
+            checkMissedVblanks((now - lastPresent) * 1000.0 / frequency);
+        lastPresent = now;
+        frameStart = 0;
+        backToBack = true;
+    }
+
+    // frame time in milliseconds at the given percentile (0-100) of the recent window
+    double percentile(double p) const
+    {
+        int count = std::min<long long>(recorded, HISTORY);
+        if (count == 0)
+            return 0;
+        float sorted[HISTORY];
+        std::copy(times, times + count, sorted);
+        int rank = std::min(count - 1, static_cast<int>(p / 100.0 * count));
+        std::nth_element(sorted, sorted + rank, sorted + count);
+        return sorted[rank];
+    }
+    void report(std::ostream &out) const
+    {
+        out << "Frame times over the last " << std::min<long long>(recorded, HISTORY) << " frames: p50 " << percentile(50)
+            << " ms, p99 " << percentile(99) << " ms (vsync " << (vsync ? "on" : "off") << ", cap " << cap << " fps)" << std::endl;
+    }
+
+private:
+    // how many recent frames decide whether vsync is being missed
+    static const int MISS_WINDOW = 30;
+
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    bool vsync = true, adaptive = false, backToBack = false;
+    int cap = 0;
+    Uint64 frequency = 1, lastPresent = 0, frameStart = 0;
+    float times[HISTORY] = {};
+    int next = 0;
+    long long recorded = 0;
+    int missed = 0, checked = 0;
+
+    void checkMissedVblanks(double ms)
+    {
+        SDL_DisplayMode mode;
+        int refresh = (SDL_GetWindowDisplayMode(window, &mode) == 0 && mode.refresh_rate > 0) ? mode.refresh_rate : 60;
+        double period = 1000.0 / refresh;
+        if (ms > period * 1.5)
+            missed++;
+        if (++checked < MISS_WINDOW)
+            return;
+        // most of the window waited an extra vblank, tear instead and cap at the refresh rate
+        if (missed > MISS_WINDOW / 2 && SDL_RenderSetVSync(renderer, 0) == 0)
+        {
+            vsync = false;
+            if (cap == 0)
+                cap = refresh;
+            std::cerr << "Missing vblanks, switching vsync off and capping at " << cap << " fps" << std::endl;
+        }
+        missed = checked = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,390 @@
+#ifndef GAME_RULES_H
+#define GAME_RULES_H
+
+#include <cstdint>
+#include <unordered_map>
+
+// result of a position, independent of who is to move
+enum Outcome : int8_t
+{
+    OUTCOME_ONGOING,
+    OUTCOME_O_WINS,
+    OUTCOME_X_WINS,
+    OUTCOME_DRAW
+};
+
+// position on an NxN grid, cells stored row major like ReferenceBoard::board
+template <int N>
+struct GridState
+{
+    char cells[N * N]; // '-', 'o' or 'x'
+    char player;       // side to move, 'o' always starts like in Player
+    int moves;         // pieces placed so far
+
+    GridState()
+    {
+        reset();
+    }
+    void reset()
+    {
+        for (int i = 0; i < N * N; i++)
+            cells[i] = '-';
+        player = 'o';
+        moves = 0;
+    }
+};
+
+// static interface every rule variant implements. Variants are plain structs
+// deriving from GameRules<Variant, State> and only define the hooks they change,
+// so search code templated over a variant never goes through a virtual call.
+//
+// A variant provides:
+//   State, Move, MAX_MOVES, SYMMETRIES
+//   int generateMoves(const State &, Move *out)
+//   void makeMove(State &, Move) / void unmakeMove(State &, Move)
+//   Outcome outcome(const State &)
+//   uint64_t hash(const State &)
+//   State transform(const State &, int symmetry)
+template <class Rules, class StateType>
+struct GameRules
+{
+    typedef StateType State;
+
+    static bool isTerminal(const State &s)
+    {
+        return Rules::outcome(s) != OUTCOME_ONGOING;
+    }
+    // symmetric positions share one canonical form: the transform with the lowest hash
+    static State canonical(const State &s)
+    {
+        State best = s;
+        uint64_t bestHash = Rules::hash(s);
+        for (int t = 1; t < Rules::SYMMETRIES; t++)
+        {
+            State next = Rules::transform(s, t);
+            uint64_t h = Rules::hash(next);
+            if (h < bestHash)
+            {
+                best = next;
+                bestHash = h;
+            }
+        }
+        return best;
+    }
+    static uint64_t canonicalHash(const State &s)
+    {
+        uint64_t best = Rules::hash(s);
+        for (int t = 1; t < Rules::SYMMETRIES; t++)
+        {
+            uint64_t h = Rules::hash(Rules::transform(s, t));
+            if (h < best)
+                best = h;
+        }
+        return best;
+    }
+};
+
+// shared implementation of K-in-a-row on an NxN grid, moves are cell indices
+template <class Rules, int N, int K>
+struct GridRules : GameRules<Rules, GridState<N>>
+{
+    typedef GridState<N> State;
+    typedef int Move;
+    static const int SIZE = N;
+    static const int CELLS = N * N;
+    static const int MAX_MOVES = N * N;
+    static const int SYMMETRIES = 8;
+    // 3^40 still fits 64 bits, on larger boards different positions would share a hash and
+    // Solver's transposition table would mix them up
+    static_assert(N * N <= 40, "the cell hash is only exact up to 40 cells");
+
+    // every run of K cells that wins, computed once
+    struct Lines
+    {
+        int count;
+        int cells[4 * N * N][K];
+
+        Lines()
+        {
+            count = 0;
+            const int dirs[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+            for (int r = 0; r < N; r++)
+            {
+                for (int c = 0; c < N; c++)
+                {
+                    for (int d = 0; d < 4; d++)
+                    {
+                        int endR = r + dirs[d][0] * (K - 1);
+                        int endC = c + dirs[d][1] * (K - 1);
+                        if (endR < 0 || endR >= N || endC < 0 || endC >= N)
+                            continue;
+                        for (int k = 0; k < K; k++)
+                            cells[count][k] = (r + dirs[d][0] * k) * N + (c + dirs[d][1] * k);
+                        count++;
+                    }
+                }
+            }
+        }
+    };
+    static const Lines &lines()
+    {
+        static const Lines table;
+        return table;
+    }
+
+    // returns the symbol that completed a line, or '-' if there is none
+    static char lineOwner(const State &s)
+    {
+        const Lines &l = lines();
+        for (int i = 0; i < l.count; i++)
+        {
+            char first = s.cells[l.cells[i][0]];
+            if (first == '-')
+                continue;
+            int k = 1;
+            while (k < K && s.cells[l.cells[i][k]] == first)
+                k++;
+            if (k == K)
+                return first;
+        }
+        return '-';
+    }
+
+    static int generateMoves(const State &s, Move *out)
+    {
+        int count = 0;
+        for (int i = 0; i < CELLS; i++)
+        {
+            if (s.cells[i] == '-')
+                out[count++] = i;
+        }
+        return count;
+    }
+    static void makeMove(State &s, Move m)
+    {
+        s.cells[m] = s.player;
+        s.player = (s.player == 'o') ? 'x' : 'o';
+        s.moves++;
+    }
+    static void unmakeMove(State &s, Move m)
+    {
+        s.cells[m] = '-';
+        s.player = (s.player == 'o') ? 'x' : 'o';
+        s.moves--;
+    }
+    static Outcome outcome(const State &s)
+    {
+        char owner = lineOwner(s);
+        if (owner == 'o')
+            return OUTCOME_O_WINS;
+        if (owner == 'x')
+            return OUTCOME_X_WINS;
+        return s.moves == CELLS ? OUTCOME_DRAW : OUTCOME_ONGOING;
+    }
+    // base 3 digits of the cells, exact up to 40 cells
+    static uint64_t hash(const State &s)
+    {
+        uint64_t h = 0;
+        for (int i = 0; i < CELLS; i++)
+            h = h * 3 + (s.cells[i] == '-' ? 0 : (s.cells[i] == 'o' ? 1 : 2));
+        return h;
+    }
+    // maps a cell through one of the 8 rotations and reflections of the square
+    static int transformCell(int cell, int symmetry)
+    {
+        int r = cell / N, c = cell % N;
+        if (symmetry & 4)
+        {
+            int t = r;
+            r = c;
+            c = t;
+        }
+        if (symmetry & 2)
+            r = N - 1 - r;
+        if (symmetry & 1)
+            c = N - 1 - c;
+        return r * N + c;
+    }
+    static State transform(const State &s, int symmetry)
+    {
+        State out = s;
+        for (int i = 0; i < CELLS; i++)
+            out.cells[Rules::transformCell(i, symmetry)] = s.cells[i];
+        return out;
+    }
+};
+
+// standard tic tac toe and its larger K-in-a-row versions
+template <int N = 3, int K = 3>
+struct ClassicRules : GridRules<ClassicRules<N, K>, N, K>
+{
+};
+
+// misere: whoever completes a line loses
+template <int N = 3, int K = 3>
+struct MisereRules : GridRules<MisereRules<N, K>, N, K>
+{
+    typedef GridRules<MisereRules<N, K>, N, K> Base;
+
+    static Outcome outcome(const GridState<N> &s)
+    {
+        char owner = Base::lineOwner(s);
+        if (owner == 'o')
+            return OUTCOME_X_WINS;
+        if (owner == 'x')
+            return OUTCOME_O_WINS;
+        return s.moves == N * N ? OUTCOME_DRAW : OUTCOME_ONGOING;
+    }
+};
+
+// gravity: pieces drop to the lowest empty cell of a column, the bottom row is N - 1
+template <int N = 3, int K = 3>
+struct GravityRules : GridRules<GravityRules<N, K>, N, K>
+{
+    static const int MAX_MOVES = N;
+    // only the left-right mirror keeps the floor where it is
+    static const int SYMMETRIES = 2;
+
+    static int generateMoves(const GridState<N> &s, int *out)
+    {
+        int count = 0;
+        for (int c = 0; c < N; c++)
+        {
+            for (int r = N - 1; r >= 0; r--)
+            {
+                if (s.cells[r * N + c] == '-')
+                {
+                    out[count++] = r * N + c;
+                    break;
+                }
+            }
+        }
+        return count;
+    }
+    static int transformCell(int cell, int symmetry)
+    {
+        return symmetry ? (cell / N) * N + (N - 1 - cell % N) : cell;
+    }
+};
+
+// negamax search with alpha-beta and a transposition table keyed by canonical hash,
+// works for any variant implementing the GameRules hooks
+template <class Rules>
+class Solver
+{
+public:
+    typedef typename Rules::State State;
+    typedef typename Rules::Move Move;
+
+    // scores are from the side to move: positive wins, negative loses, quicker wins score higher
+    static const int WIN_SCORE = 1000;
+
+    // returns the score of the position and stores the best move in bestMove if there is one
+    int solve(const State &start, Move *bestMove = nullptr)
+    {
+        State s = start;
+        Move moves[Rules::MAX_MOVES];
+        int count = Rules::isTerminal(s) ? 0 : Rules::generateMoves(s, moves);
+        if (count == 0)
+            return search(s, 0, -WIN_SCORE - 1, WIN_SCORE + 1);
+
+        int best = -WIN_SCORE - 1;
+        for (int i = 0; i < count; i++)
+        {
+            Rules::makeMove(s, moves[i]);
+            int score = -search(s, 1, -WIN_SCORE - 1, WIN_SCORE + 1);
+            Rules::unmakeMove(s, moves[i]);
+            if (score > best)
+            {
+                best = score;
+                if (bestMove)
+                    *bestMove = moves[i];
+            }
+        }
+        return best;
+    }
+    void clear()
+    {
+        table.clear();
+        nodes = 0;
+    }
+    long long nodeCount() const
+    {
+        return nodes;
+    }
+
+private:
+    enum Bound : int8_t
+    {
+        BOUND_EXACT,
+        BOUND_LOWER,
+        BOUND_UPPER
+    };
+    struct Entry
+    {
+        int score; // measured from this position, so it does not depend on the ply
+        Bound bound;
+    };
+    std::unordered_map<uint64_t, Entry> table;
+    long long nodes = 0;
+
+    static int terminalScore(const State &s, Outcome result, int ply)
+    {
+        if (result == OUTCOME_DRAW)
+            return 0;
+        bool moverWon = (result == OUTCOME_O_WINS) == (s.player == 'o');
+        return moverWon ? WIN_SCORE - ply : ply - WIN_SCORE;
+    }
+    int search(State &s, int ply, int alpha, int beta)
+    {
+        nodes++;
+        Outcome result = Rules::outcome(s);
+        if (result != OUTCOME_ONGOING)
+            return terminalScore(s, result, ply);
+
+        // every variant here fixes the side to move from the pieces on the board,
+        // so the canonical cell hash alone identifies the position
+        uint64_t key = Rules::canonicalHash(s);
+        auto found = table.find(key);
+        if (found != table.end())
+        {
+            // stored scores are ply independent, shift them to this ply
+            int stored = found->second.score;
+            if (stored > 0)
+                stored -= ply;
+            else if (stored < 0)
+                stored += ply;
+            if (found->second.bound == BOUND_EXACT)
+                return stored;
+            if (found->second.bound == BOUND_LOWER && stored >= beta)
+                return stored;
+            if (found->second.bound == BOUND_UPPER && stored <= alpha)
+                return stored;
+        }
+
+        int originalAlpha = alpha;
+        int best = -WIN_SCORE - 1;
+        Move moves[Rules::MAX_MOVES];
+        int count = Rules::generateMoves(s, moves);
+        for (int i = 0; i < count; i++)
+        {
+            Rules::makeMove(s, moves[i]);
+            int score = -search(s, ply + 1, -beta, -alpha);
+            Rules::unmakeMove(s, moves[i]);
+            if (score > best)
+                best = score;
+            if (best > alpha)
+                alpha = best;
+            if (alpha >= beta)
+                break;
+        }
+
+        Entry entry;
+        entry.score = best > 0 ? best + ply : (best < 0 ? best - ply : 0);
+        entry.bound = best <= originalAlpha ? BOUND_UPPER : (best >= beta ? BOUND_LOWER : BOUND_EXACT);
+        table[key] = entry;
+        return best;
+    }
+};
+
+#endif
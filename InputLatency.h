@@ -0,0 +1,105 @@
+#ifndef INPUT_LATENCY_H
+#define INPUT_LATENCY_H
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+// Click-to-present latency: from the SDL timestamp of an input event to the return of the
+// first SDL_RenderPresent that shows what it changed. Split into the time the event waited
+// in SDL's queue (millisecond timestamps) and the time from handling it to the present
+// (high resolution counter), so a slow loop and a slow present can be told apart. Whatever
+// the compositor and display add after the present is not visible from here.
+class InputLatency
+{
+public:
+    // 1 ms buckets, the last one also takes everything slower
+    static const int BUCKETS = 100;
+    // clicks handled but not presented yet that are tracked, more are dropped
+    static const int MAX_PENDING = 16;
+
+    InputLatency()
+    {
+        frequency = SDL_GetPerformanceFrequency();
+    }
+    // call when handling an event whose result should be measured, with its timestamp
+    void handled(Uint32 eventTimestamp)
+    {
+        if (pending == MAX_PENDING)
+            return;
+        Uint32 ticks = SDL_GetTicks();
+        // the timestamp may be a little ahead of the ticks read here, never count that as negative
+        queuedMs[pending] = ticks > eventTimestamp ? ticks - eventTimestamp : 0;
+        handledAt[pending] = SDL_GetPerformanceCounter();
+        pending++;
+    }
+    // call right after SDL_RenderPresent, records every click handled since the last present
+    void framePresented()
+    {
+        if (pending == 0)
+            return;
+        Uint64 now = SDL_GetPerformanceCounter();
+        for (int i = 0; i < pending; i++)
+        {
+            double loopMs = (now - handledAt[i]) * 1000.0 / frequency;
+            double ms = queuedMs[i] + loopMs;
+            histogram[std::min(BUCKETS - 1, static_cast<int>(ms))]++;
+            recorded++;
+            totalMs += ms;
+            totalQueuedMs += queuedMs[i];
+            maxMs = std::max(maxMs, ms);
+            lastMs = ms;
+        }
+        pending = 0;
+    }
+
+    long long count() const
+    {
+        return recorded;
+    }
+    double last() const
+    {
+        return lastMs;
+    }
+    // upper edge of the bucket holding the given percentile (0-100), in ms
+    int percentile(double p) const
+    {
+        if (recorded == 0)
+            return 0;
+        long long rank = std::min(recorded - 1, static_cast<long long>(p / 100.0 * recorded));
+        long long seen = 0;
+        for (int b = 0; b < BUCKETS; b++)
+        {
+            seen += histogram[b];
+            if (seen > rank)
+                return b + 1;
+        }
+        return BUCKETS;
+    }
+    void report(std::ostream &out) const
+    {
+        if (recorded == 0)
+            return;
+        out << "Click to present over " << recorded << " clicks: average " << totalMs / recorded << " ms (queued "
+            << totalQueuedMs / recorded << " ms), p50 " << percentile(50) << " ms, p99 " << percentile(99) << " ms, max "
+            << maxMs << " ms" << std::endl;
+        for (int b = 0; b < BUCKETS; b++)
+        {
+            if (histogram[b] == 0)
+                continue;
+            out << "  " << b << (b == BUCKETS - 1 ? "+" : "-" + std::to_string(b + 1)) << " ms: " << histogram[b] << std::endl;
+        }
+    }
+
+private:
+    long long histogram[BUCKETS] = {};
+    long long recorded = 0;
+    double totalMs = 0, totalQueuedMs = 0, maxMs = 0, lastMs = 0;
+    Uint32 queuedMs[MAX_PENDING] = {};
+    Uint64 handledAt[MAX_PENDING] = {};
+    int pending = 0;
+    Uint64 frequency = 1;
+};
+
+#endif
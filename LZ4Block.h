@@ -0,0 +1,178 @@
+#ifndef LZ4_BLOCK_H
+#define LZ4_BLOCK_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Compression in the LZ4 block format: sequences of a token, literals, a two byte offset and
+// a match length, no entropy coding, so decompressing is little more than memcpy. The
+// compressor is a greedy single pass with one hash table, good enough for build time.
+class LZ4Block
+{
+public:
+    // worst case compressed size, for incompressible input
+    static size_t bound(size_t size)
+    {
+        return size + size / 255 + 16;
+    }
+
+    // compresses size bytes into dst, returns the compressed size or 0 if capacity is too small
+    static size_t compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity)
+    {
+        std::vector<int64_t> table(size_t(1) << HASH_BITS, -1);
+        size_t ip = 0, anchor = 0, op = 0;
+        // matches have to start MFLIMIT bytes before the end and leave LAST_LITERALS to it
+        size_t limit = size > MFLIMIT ? size - MFLIMIT : 0;
+        while (ip < limit)
+        {
+            uint32_t sequence = read32(src + ip);
+            uint32_t h = hash(sequence);
+            int64_t ref = table[h];
+            table[h] = static_cast<int64_t>(ip);
+            if (ref < 0 || ip - ref > MAX_OFFSET || read32(src + ref) != sequence)
+            {
+                // step faster through data that doesn't match
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+            size_t length = MIN_MATCH;
+            size_t matchLimit = size - LAST_LITERALS;
+            while (ip + length < matchLimit && src[ref + length] == src[ip + length])
+                length++;
+            if (!writeSequence(dst, capacity, op, src + anchor, ip - anchor, ip - ref, length))
+                return 0;
+            ip += length;
+            anchor = ip;
+            if (ip >= 2 && ip < limit)
+                table[hash(read32(src + ip - 2))] = static_cast<int64_t>(ip - 2);
+        }
+        // the rest goes out as literals of a last sequence without a match
+        if (!writeSequence(dst, capacity, op, src + anchor, size - anchor, 0, 0))
+            return 0;
+        return op;
+    }
+
+    // decompresses exactly dstSize bytes, returns false for input that is corrupt or doesn't
+    // decompress to that size. Never reads or writes outside the two buffers.
+    static bool decompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize)
+    {
+        size_t ip = 0, op = 0;
+        while (ip < srcSize)
+        {
+            uint8_t token = src[ip++];
+            size_t literals = token >> 4;
+            if (literals == 15 && !readLength(src, srcSize, ip, literals))
+                return false;
+            if (literals > srcSize - ip || literals > dstSize - op)
+                return false;
+            if (literals)
+                memcpy(dst + op, src + ip, literals);
+            ip += literals;
+            op += literals;
+            // the last sequence ends after its literals
+            if (ip == srcSize)
+                break;
+            if (srcSize - ip < 2)
+                return false;
+            size_t offset = src[ip] | (src[ip + 1] << 8);
+            ip += 2;
+            size_t length = token & 15;
+            if (length == 15 && !readLength(src, srcSize, ip, length))
+                return false;
+            length += MIN_MATCH;
+            if (offset == 0 || offset > op || length > dstSize - op)
+                return false;
+            copyMatch(dst + op, offset, length);
+            op += length;
+        }
+        return op == dstSize;
+    }
+
+private:
+    static const size_t MIN_MATCH = 4, LAST_LITERALS = 5, MFLIMIT = 12, MAX_OFFSET = 65535;
+    static const int HASH_BITS = 16;
+
+    static uint32_t read32(const uint8_t *p)
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    static uint32_t hash(uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+    // a length nibble of 15 continues in bytes, each 255 means another one follows
+    static bool readLength(const uint8_t *src, size_t srcSize, size_t &ip, size_t &length)
+    {
+        uint8_t b;
+        do
+        {
+            if (ip >= srcSize)
+                return false;
+            b = src[ip++];
+            length += b;
+        } while (b == 255);
+        return true;
+    }
+    static bool writeLength(uint8_t *dst, size_t capacity, size_t &op, size_t rest)
+    {
+        for (; rest >= 255; rest -= 255)
+        {
+            if (op >= capacity)
+                return false;
+            dst[op++] = 255;
+        }
+        if (op >= capacity)
+            return false;
+        dst[op++] = static_cast<uint8_t>(rest);
+        return true;
+    }
+    // a match length of 0 writes the final, literal only sequence
+    static bool writeSequence(uint8_t *dst, size_t capacity, size_t &op, const uint8_t *literals, size_t literalCount,
+                              size_t offset, size_t matchLength)
+    {
+        if (op >= capacity)
+            return false;
+        size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+        dst[op++] = static_cast<uint8_t>((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCode, 15));
+        if (literalCount >= 15 && !writeLength(dst, capacity, op, literalCount - 15))
+            return false;
+        if (literalCount > capacity - op)
+            return false;
+        if (literalCount)
+            memcpy(dst + op, literals, literalCount);
+        op += literalCount;
+        if (matchLength == 0)
+            return true;
+        if (capacity - op < 2)
+            return false;
+        dst[op++] = static_cast<uint8_t>(offset);
+        dst[op++] = static_cast<uint8_t>(offset >> 8);
+        return matchCode < 15 || writeLength(dst, capacity, op, matchCode - 15);
+    }
+    // the match may overlap what it writes (a run of one pixel is offset 4), the bytes behind
+    // repeat every offset bytes, so copying from the match start in doubling chunks that
+    // never overlap rebuilds the run
+    static void copyMatch(uint8_t *out, size_t offset, size_t length)
+    {
+        const uint8_t *match = out - offset;
+        if (offset >= length)
+        {
+            memcpy(out, match, length);
+            return;
+        }
+        size_t copied = 0;
+        while (copied < length)
+        {
+            size_t n = std::min(length - copied, offset + copied);
+            memcpy(out + copied, match, n);
+            copied += n;
+        }
+    }
+};
+
+#endif
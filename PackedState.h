@@ -0,0 +1,244 @@
+#ifndef PACKED_STATE_H
+#define PACKED_STATE_H
+
+#include <cstdint>
+#include "GameRules.h"
+
+// A whole 3x3 game in 16 bits: the cells as base 3 digits (0 empty, 1 o, 2 x, cell 0 is
+// the lowest digit) in the low 15 bits and the side to move in bit 15 (set when x moves).
+// Move making is one add and the terminal test is a lookup in a 19683 byte table.
+struct PackedState
+{
+    static const uint16_t TURN_BIT = 0x8000;
+    static const uint16_t CELL_MASK = 0x7FFF;
+    static const int POSITIONS = 19683; // 3^9
+
+    uint16_t bits;
+
+    PackedState() : bits(0)
+    {
+    }
+    explicit PackedState(uint16_t packed) : bits(packed)
+    {
+    }
+
+    static const uint16_t *powers()
+    {
+        static const uint16_t pow3[9] = {1, 3, 9, 27, 81, 243, 729, 2187, 6561};
+        return pow3;
+    }
+    static PackedState pack(const char board[3][3], char player)
+    {
+        uint16_t cells = 0;
+        for (int i = 8; i >= 0; i--)
+        {
+            char c = board[i / 3][i % 3];
+            cells = cells * 3 + (c == '-' ? 0 : (c == 'o' ? 1 : 2));
+        }
+        return PackedState(cells | (player == 'x' ? TURN_BIT : 0));
+    }
+    static PackedState pack(const GridState<3> &s)
+    {
+        char board[3][3];
+        for (int i = 0; i < 9; i++)
+            board[i / 3][i % 3] = s.cells[i];
+        return pack(board, s.player);
+    }
+    void unpack(char board[3][3], char &player) const
+    {
+        uint16_t cells = bits & CELL_MASK;
+        for (int i = 0; i < 9; i++)
+        {
+            int digit = cells % 3;
+            cells /= 3;
+            board[i / 3][i % 3] = digit == 0 ? '-' : (digit == 1 ? 'o' : 'x');
+        }
+        player = this->player();
+    }
+    GridState<3> toState() const
+    {
+        GridState<3> s;
+        char board[3][3];
+        unpack(board, s.player);
+        s.moves = 0;
+        for (int i = 0; i < 9; i++)
+        {
+            s.cells[i] = board[i / 3][i % 3];
+            if (s.cells[i] != '-')
+                s.moves++;
+        }
+        return s;
+    }
+
+    char player() const
+    {
+        return (bits & TURN_BIT) ? 'x' : 'o';
+    }
+    char cell(int index) const
+    {
+        int digit = ((bits & CELL_MASK) / powers()[index]) % 3;
+        return digit == 0 ? '-' : (digit == 1 ? 'o' : 'x');
+    }
+    // places the side to move on an empty cell and passes the turn, false if the cell is taken
+    bool makeMove(int index)
+    {
+        if (cell(index) != '-')
+            return false;
+        bits += powers()[index] * ((bits & TURN_BIT) ? 2 : 1);
+        bits ^= TURN_BIT;
+        return true;
+    }
+    Outcome outcome() const
+    {
+        return static_cast<Outcome>(outcomeTable()[bits & CELL_MASK]);
+    }
+    bool isTerminal() const
+    {
+        return outcome() != OUTCOME_ONGOING;
+    }
+
+private:
+    // outcome of every cell pattern, filled once from ClassicRules
+    static const uint8_t *outcomeTable()
+    {
+        struct Table
+        {
+            uint8_t outcomes[POSITIONS];
+
+            Table()
+            {
+                for (int i = 0; i < POSITIONS; i++)
+                    outcomes[i] = ClassicRules<3, 3>::outcome(PackedState(static_cast<uint16_t>(i)).toState());
+            }
+        };
+        static const Table table;
+        return table.outcomes;
+    }
+};
+
+// Larger boards: 2 bits per cell (00 empty, 01 o, 10 x) in 64-bit words, side to move in
+// the bit after the last cell. Lines of K are tested with precomputed word masks.
+template <int N, int K>
+struct PackedGrid
+{
+    static const int CELLS = N * N;
+    static const int WORDS = (2 * CELLS + 1 + 63) / 64;
+
+    uint64_t words[WORDS];
+
+    PackedGrid()
+    {
+        for (int w = 0; w < WORDS; w++)
+            words[w] = 0;
+    }
+
+    static PackedGrid pack(const GridState<N> &s)
+    {
+        PackedGrid p;
+        for (int i = 0; i < CELLS; i++)
+        {
+            if (s.cells[i] != '-')
+                p.set(i, s.cells[i]);
+        }
+        if (s.player == 'x')
+            p.words[CELLS * 2 / 64] |= uint64_t(1) << (CELLS * 2 % 64);
+        return p;
+    }
+    GridState<N> toState() const
+    {
+        GridState<N> s;
+        s.moves = 0;
+        for (int i = 0; i < CELLS; i++)
+        {
+            s.cells[i] = cell(i);
+            if (s.cells[i] != '-')
+                s.moves++;
+        }
+        s.player = player();
+        return s;
+    }
+
+    char cell(int index) const
+    {
+        int code = (words[index * 2 / 64] >> (index * 2 % 64)) & 3;
+        return code == 0 ? '-' : (code == 1 ? 'o' : 'x');
+    }
+    void set(int index, char symbol)
+    {
+        uint64_t code = symbol == 'o' ? 1 : 2;
+        words[index * 2 / 64] |= code << (index * 2 % 64);
+    }
+    char player() const
+    {
+        return ((words[CELLS * 2 / 64] >> (CELLS * 2 % 64)) & 1) ? 'x' : 'o';
+    }
+    bool makeMove(int index)
+    {
+        if (cell(index) != '-')
+            return false;
+        set(index, player());
+        words[CELLS * 2 / 64] ^= uint64_t(1) << (CELLS * 2 % 64);
+        return true;
+    }
+    Outcome outcome() const
+    {
+        const Masks &m = masks();
+        bool full = true;
+        for (int w = 0; w < WORDS; w++)
+        {
+            // a cell is taken when either of its two bits is set
+            uint64_t taken = (words[w] | (words[w] >> 1)) & m.lowBits[w];
+            if (taken != m.lowBits[w])
+                full = false;
+        }
+        for (int l = 0; l < m.count; l++)
+        {
+            bool oLine = true, xLine = true;
+            for (int w = 0; w < WORDS; w++)
+            {
+                uint64_t oMask = m.lines[l][w];
+                oLine = oLine && (words[w] & oMask) == oMask;
+                xLine = xLine && (words[w] & (oMask << 1)) == (oMask << 1);
+            }
+            if (oLine)
+                return OUTCOME_O_WINS;
+            if (xLine)
+                return OUTCOME_X_WINS;
+        }
+        return full ? OUTCOME_DRAW : OUTCOME_ONGOING;
+    }
+
+private:
+    // for every line the low bit of each of its cells, plus the low bit of every cell
+    struct Masks
+    {
+        int count;
+        uint64_t lines[4 * CELLS][WORDS];
+        uint64_t lowBits[WORDS];
+
+        Masks()
+        {
+            typedef ClassicRules<N, K> Rules;
+            const typename Rules::Lines &l = Rules::lines();
+            count = l.count;
+            for (int i = 0; i < count; i++)
+            {
+                for (int w = 0; w < WORDS; w++)
+                    lines[i][w] = 0;
+                for (int k = 0; k < K; k++)
+                    lines[i][l.cells[i][k] * 2 / 64] |= uint64_t(1) << (l.cells[i][k] * 2 % 64);
+            }
+            for (int w = 0; w < WORDS; w++)
+                lowBits[w] = 0;
+            for (int c = 0; c < CELLS; c++)
+                lowBits[c * 2 / 64] |= uint64_t(1) << (c * 2 % 64);
+        }
+    };
+    static const Masks &masks()
+    {
+        static const Masks table;
+        return table;
+    }
+};
+
+#endif
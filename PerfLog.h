@@ -0,0 +1,174 @@
+#ifndef PERF_LOG_H
+#define PERF_LOG_H
+
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include "Trace.h"
+
+// Per-phase timing of presented frames from the high resolution counter, kept in a fixed
+// ring buffer so recording never allocates. Phases may be entered several times per frame,
+// their time adds up. Loop iterations that present nothing are dropped by beginFrame. While
+// tracing, every phase is also a trace event named after it.
+class PerfLog
+{
+public:
+    enum Phase
+    {
+        PHASE_EVENTS,
+        PHASE_UPDATE,
+        PHASE_BUILD,
+        PHASE_SUBMIT,
+        PHASE_PRESENT,
+        PHASE_COUNT
+    };
+    // frames kept for the averages, the graph and the export
+    static const int FRAMES = 256;
+
+    static const char *phaseName(int phase)
+    {
+        static const char *const names[PHASE_COUNT] = {"events", "update", "build", "submit", "present"};
+        return names[phase];
+    }
+
+    PerfLog()
+    {
+        frequency = SDL_GetPerformanceFrequency();
+    }
+    // starts measuring a loop iteration, whatever the previous one measured without presenting is dropped
+    void beginFrame()
+    {
+        current = Frame();
+    }
+    void begin(Phase phase)
+    {
+        traceBegin[phase] = Trace::enabled() ? Trace::now() : 0;
+        openedAt[phase] = SDL_GetPerformanceCounter();
+    }
+    void end(Phase phase)
+    {
+        current.ticks[phase] += SDL_GetPerformanceCounter() - openedAt[phase];
+        if (traceBegin[phase] && Trace::enabled())
+            Trace::record(phaseName(phase), traceBegin[phase], Trace::now());
+    }
+    // measures one phase for as long as it is in scope
+    class Scope
+    {
+    public:
+        Scope(PerfLog &target, Phase measured) : log(target), phase(measured)
+        {
+            log.begin(phase);
+        }
+        ~Scope()
+        {
+            log.end(phase);
+        }
+
+    private:
+        PerfLog &log;
+        Phase phase;
+    };
+    // call right after the frame was presented, stores it in the ring
+    void framePresented()
+    {
+        current.presented = SDL_GetPerformanceCounter();
+        frames[next] = current;
+        next = (next + 1) % FRAMES;
+        recorded++;
+    }
+
+    int count() const
+    {
+        return recorded < FRAMES ? static_cast<int>(recorded) : FRAMES;
+    }
+    // ms spent in a phase, age 0 is the last presented frame
+    double phaseMs(int age, int phase) const
+    {
+        return toMs(at(age).ticks[phase]);
+    }
+    // ms the frame spent working, all its phases. Unlike the time between presents this
+    // never includes the loop waiting for input.
+    double frameMs(int age) const
+    {
+        Uint64 ticks = 0;
+        for (int p = 0; p < PHASE_COUNT; p++)
+            ticks += at(age).ticks[p];
+        return toMs(ticks);
+    }
+    // ms between the presents of a frame and the one before it, 0 for the oldest frame
+    double intervalMs(int age) const
+    {
+        if (age + 1 >= count())
+            return 0;
+        return toMs(at(age).presented - at(age + 1).presented);
+    }
+    // averages over the last frames, at most FRAMES
+    double averagePhaseMs(int phase, int window) const
+    {
+        int n = window < count() ? window : count();
+        double total = 0;
+        for (int age = 0; age < n; age++)
+            total += phaseMs(age, phase);
+        return n ? total / n : 0;
+    }
+    double averageFrameMs(int window) const
+    {
+        int n = window < count() ? window : count();
+        double total = 0;
+        for (int age = 0; age < n; age++)
+            total += frameMs(age);
+        return n ? total / n : 0;
+    }
+    // average time between presents, only a frame rate while the loop redraws continuously
+    double averageIntervalMs(int window) const
+    {
+        int n = (window < count() ? window : count()) - 1;
+        if (n <= 0)
+            return 0;
+        return toMs(at(0).presented - at(n).presented) / n;
+    }
+
+    // writes the buffered frames as CSV, oldest first
+    bool write(const char *path) const
+    {
+        FILE *file = fopen(path, "w");
+        if (!file)
+            return false;
+        fprintf(file, "frame,time_ms,frame_ms");
+        for (int p = 0; p < PHASE_COUNT; p++)
+            fprintf(file, ",%s_ms", phaseName(p));
+        fprintf(file, "\n");
+        for (int age = count() - 1; age >= 0; age--)
+        {
+            fprintf(file, "%lld,%.4f,%.4f", recorded - 1 - age, toMs(at(age).presented), frameMs(age));
+            for (int p = 0; p < PHASE_COUNT; p++)
+                fprintf(file, ",%.4f", phaseMs(age, p));
+            fprintf(file, "\n");
+        }
+        return fclose(file) == 0;
+    }
+
+private:
+    struct Frame
+    {
+        Uint64 presented = 0;
+        Uint64 ticks[PHASE_COUNT] = {};
+    };
+    Frame frames[FRAMES];
+    Frame current;
+    int next = 0;
+    long long recorded = 0;
+    Uint64 openedAt[PHASE_COUNT] = {};
+    uint64_t traceBegin[PHASE_COUNT] = {};
+    Uint64 frequency = 1;
+
+    const Frame &at(int age) const
+    {
+        return frames[(next - 1 - age + 2 * FRAMES) % FRAMES];
+    }
+    double toMs(Uint64 ticks) const
+    {
+        return ticks * 1000.0 / frequency;
+    }
+};
+
+#endif
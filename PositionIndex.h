@@ -0,0 +1,149 @@
+#ifndef POSITION_INDEX_H
+#define POSITION_INDEX_H
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include "GameRules.h"
+
+// Dense numbering of every NxN position reachable by piece counts: 'o' moves first, so a
+// board with k pieces holds ceil(k/2) o's and floor(k/2) x's. Positions are grouped by k,
+// then ranked by which cells are occupied and which of those hold an o, both through the
+// combinatorial number system. Every index in [0, size()) is a valid position, so tables
+// of per-position data can be flat arrays instead of hash maps.
+// Exact for N <= 5, larger boards overflow 64 bits.
+template <int N>
+class PositionIndex
+{
+public:
+    static const int CELLS = N * N;
+
+    PositionIndex()
+    {
+        for (int n = 0; n <= CELLS; n++)
+        {
+            choose[n][0] = 1;
+            for (int k = 1; k <= CELLS; k++)
+                choose[n][k] = (n == 0) ? 0 : choose[n - 1][k - 1] + choose[n - 1][k];
+        }
+        offset[0] = 0;
+        for (int k = 0; k <= CELLS; k++)
+            offset[k + 1] = offset[k] + choose[CELLS][k] * choose[k][(k + 1) / 2];
+    }
+    uint64_t size() const
+    {
+        return offset[CELLS + 1];
+    }
+    // positions with k pieces occupy the contiguous range [layerBegin(k), layerBegin(k + 1))
+    uint64_t layerBegin(int k) const
+    {
+        return offset[k];
+    }
+    uint64_t rank(const GridState<N> &s) const
+    {
+        int occupied[CELLS];
+        int k = 0;
+        for (int i = 0; i < CELLS; i++)
+        {
+            if (s.cells[i] != '-')
+                occupied[k++] = i;
+        }
+        uint64_t cellRank = 0, oRank = 0;
+        int oSeen = 0;
+        for (int i = 0; i < k; i++)
+        {
+            cellRank += choose[occupied[i]][i + 1];
+            if (s.cells[occupied[i]] == 'o')
+            {
+                oSeen++;
+                oRank += choose[i][oSeen];
+            }
+        }
+        return offset[k] + cellRank * choose[k][(k + 1) / 2] + oRank;
+    }
+    GridState<N> unrank(uint64_t index) const
+    {
+        int k = 0;
+        while (offset[k + 1] <= index)
+            k++;
+        int oCount = (k + 1) / 2;
+        uint64_t rest = index - offset[k];
+        uint64_t cellRank = rest / choose[k][oCount];
+        uint64_t oRank = rest % choose[k][oCount];
+
+        int occupied[CELLS];
+        decode(cellRank, k, CELLS, occupied);
+        int oSlots[CELLS];
+        decode(oRank, oCount, k, oSlots);
+
+        GridState<N> s;
+        for (int i = 0; i < k; i++)
+            s.cells[occupied[i]] = 'x';
+        for (int i = 0; i < oCount; i++)
+            s.cells[occupied[oSlots[i]]] = 'o';
+        s.moves = k;
+        s.player = (k % 2 == 0) ? 'o' : 'x';
+        return s;
+    }
+
+private:
+    uint64_t choose[CELLS + 1][CELLS + 1];
+    uint64_t offset[CELLS + 2];
+
+    // inverse of the combinatorial number system: the k-subset of [0, n) with the given rank, ascending
+    void decode(uint64_t rank, int k, int n, int *out) const
+    {
+        int c = n - 1;
+        for (int i = k; i >= 1; i--)
+        {
+            while (choose[c][i] > rank)
+                c--;
+            out[i - 1] = c;
+            rank -= choose[c][i];
+            c--;
+        }
+    }
+};
+
+// PositionIndex composed with the symmetry reduction of a rule variant: one dense index
+// per equivalence class. The class representatives are found once at construction by
+// walking the full index, so this is meant for boards up to 4x4.
+template <class Rules>
+class SymmetricPositionIndex
+{
+public:
+    typedef typename Rules::State State;
+
+    SymmetricPositionIndex()
+    {
+        for (uint64_t r = 0; r < full.size(); r++)
+        {
+            if (full.rank(Rules::canonical(full.unrank(r))) == r)
+                representatives.push_back(r);
+        }
+    }
+    uint64_t size() const
+    {
+        return representatives.size();
+    }
+    uint64_t rank(const State &s) const
+    {
+        uint64_t r = full.rank(Rules::canonical(s));
+        return std::lower_bound(representatives.begin(), representatives.end(), r) - representatives.begin();
+    }
+    // returns the canonical member of the class
+    State unrank(uint64_t index) const
+    {
+        return full.unrank(representatives[index]);
+    }
+    const PositionIndex<Rules::SIZE> &fullIndex() const
+    {
+        return full;
+    }
+
+private:
+    PositionIndex<Rules::SIZE> full;
+    std::vector<uint64_t> representatives;
+};
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef POSITION_TABLE_H
+#define POSITION_TABLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include "GameRules.h"
+#include "PositionIndex.h"
+#include "Trace.h"
+#include "AllocStats.h"
+
+// Perfect-play result of every position of a variant, stored in flat arrays indexed by
+// PositionIndex rank. Positions are encoded as their rank, so callers holding many
+// positions pass one contiguous array to evaluateBatch instead of checking boards one by one.
+// Meant for boards up to 4x4, where every rank fits in 32 bits.
+template <class Rules>
+class PositionTable
+{
+public:
+    typedef typename Rules::State State;
+    static const int CELLS = Rules::CELLS;
+
+    // solves every position, one piece-count layer at a time from the full board down,
+    // since a position only depends on the layer after it. Each layer is split across threads.
+    explicit PositionTable(int threads = 0)
+    {
+        TRACE_SCOPE("PositionTable::build");
+        AllocStats::Scope allocScope(AllocStats::ALLOC_AI);
+        uint64_t total = index.size();
+        outcomes.assign(total, OUTCOME_ONGOING);
+        bestMoves.assign(total, -1);
+        depths.assign(total, 0);
+
+        threads = threadCount(threads);
+        for (int k = CELLS; k >= 0; k--)
+        {
+            uint64_t begin = index.layerBegin(k), end = index.layerBegin(k + 1);
+            parallelFor(begin, end, threads, [this](uint64_t from, uint64_t to)
+                        {
+                            TRACE_SCOPE("PositionTable::solveLayer");
+                            AllocStats::Scope allocScope(AllocStats::ALLOC_AI);
+                            for (uint64_t r = from; r < to; r++)
+                                solvePosition(r);
+                        });
+        }
+    }
+
+    uint64_t size() const
+    {
+        return index.size();
+    }
+    const PositionIndex<Rules::SIZE> &positionIndex() const
+    {
+        return index;
+    }
+    uint32_t encode(const State &s) const
+    {
+        return static_cast<uint32_t>(index.rank(s));
+    }
+    Outcome outcome(uint32_t position) const
+    {
+        return static_cast<Outcome>(outcomes[position]);
+    }
+    // cell index of the best move for the side to move, -1 for finished games
+    int bestMove(uint32_t position) const
+    {
+        return bestMoves[position];
+    }
+
+    // looks up count encoded positions at once. Results go to the matching slots of
+    // outOutcomes and outBestMoves, either of which may be null. Large batches are split
+    // across threads (0 picks the hardware concurrency).
+    void evaluateBatch(const uint32_t *positions, size_t count, Outcome *outOutcomes, int8_t *outBestMoves, int threads = 0) const
+    {
+        TRACE_SCOPE("PositionTable::evaluateBatch");
+        // below this many positions per thread, starting threads costs more than it saves
+        const size_t MIN_PER_THREAD = 1 << 15;
+        threads = std::min<size_t>(threadCount(threads), std::max<size_t>(1, count / MIN_PER_THREAD));
+        const int8_t *outcomeData = outcomes.data();
+        const int8_t *moveData = bestMoves.data();
+        parallelFor(0, count, threads, [=](uint64_t from, uint64_t to)
+                    {
+                        // separate plain gather loops over structure-of-arrays tables vectorize cleanly
+                        if (outOutcomes)
+                        {
+                            for (uint64_t i = from; i < to; i++)
+                                outOutcomes[i] = static_cast<Outcome>(outcomeData[positions[i]]);
+                        }
+                        if (outBestMoves)
+                        {
+                            for (uint64_t i = from; i < to; i++)
+                                outBestMoves[i] = moveData[positions[i]];
+                        }
+                    });
+    }
+
+private:
+    PositionIndex<Rules::SIZE> index;
+    std::vector<int8_t> outcomes;  // Outcome under perfect play
+    std::vector<int8_t> bestMoves; // cell index or -1
+    std::vector<int8_t> depths;    // moves until the game ends under perfect play
+
+    static int threadCount(int requested)
+    {
+        if (requested > 0)
+            return requested;
+        int hardware = static_cast<int>(std::thread::hardware_concurrency());
+        return hardware > 0 ? hardware : 1;
+    }
+    template <class Work>
+    static void parallelFor(uint64_t begin, uint64_t end, int threads, Work work)
+    {
+        uint64_t count = end - begin;
+        if (threads <= 1 || count < static_cast<uint64_t>(threads))
+        {
+            work(begin, end);
+            return;
+        }
+        std::vector<std::thread> workers;
+        uint64_t chunk = (count + threads - 1) / threads;
+        for (uint64_t from = begin; from < end; from += chunk)
+            workers.emplace_back(work, from, std::min(end, from + chunk));
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    // ranks a result for the side to move: quick wins first, then draws, then slow losses
+    static int score(Outcome result, int depth, char mover)
+    {
+        if (result == OUTCOME_DRAW)
+            return 0;
+        bool moverWins = (result == OUTCOME_O_WINS) == (mover == 'o');
+        return moverWins ? 1000 - depth : depth - 1000;
+    }
+    void solvePosition(uint64_t r)
+    {
+        State s = index.unrank(r);
+        Outcome result = Rules::outcome(s);
+        if (result != OUTCOME_ONGOING)
+        {
+            outcomes[r] = result;
+            return;
+        }
+        typename Rules::Move moves[Rules::MAX_MOVES];
+        int count = Rules::generateMoves(s, moves);
+        int best = -2000;
+        for (int i = 0; i < count; i++)
+        {
+            Rules::makeMove(s, moves[i]);
+            uint64_t child = index.rank(s);
+            Rules::unmakeMove(s, moves[i]);
+            Outcome childResult = static_cast<Outcome>(outcomes[child]);
+            int childDepth = depths[child] + 1;
+            int childScore = score(childResult, childDepth, s.player);
+            if (childScore > best)
+            {
+                best = childScore;
+                outcomes[r] = childResult;
+                bestMoves[r] = static_cast<int8_t>(moves[i]);
+                depths[r] = static_cast<int8_t>(childDepth);
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+// Scoped timing events written as Chrome trace-event JSON (chrome://tracing, Perfetto).
+// Every thread appends to its own buffer, so recording takes no locks: the buffer is
+// published once through a lock-free list, and its event counts with release stores. A
+// buffer is a chain of fixed chunks, so a thread only allocates once per CHUNK_EVENTS.
+// When a thread exits its buffer goes back to a pool and the next new thread appends to
+// it, so threads spawned per task don't add a buffer each.
+// While tracing is off a TRACE_SCOPE costs one relaxed load and a branch.
+class Trace
+{
+public:
+    static const uint32_t CHUNK_EVENTS = 4096;
+
+    static bool enabled()
+    {
+        return flag().load(std::memory_order_relaxed);
+    }
+    // the thread calling start is named "main" in the trace
+    static void start()
+    {
+        origin() = now();
+        local().name = "main";
+        flag().store(true, std::memory_order_release);
+    }
+    // stops tracing and writes every thread's events, call once the other threads are done
+    static bool write(const char *path)
+    {
+        flag().store(false, std::memory_order_release);
+        FILE *file = fopen(path, "w");
+        if (!file)
+            return false;
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        bool first = true;
+        for (Buffer *b = head().load(std::memory_order_acquire); b; b = b->next)
+        {
+            if (b->name)
+                fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", b->id, b->name);
+            else
+                fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"worker %u\"}}", first ? "" : ",\n", b->id, b->id);
+            first = false;
+            for (Chunk *c = &b->first; c; c = c->next.load(std::memory_order_acquire))
+            {
+                uint32_t count = c->count.load(std::memory_order_acquire);
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    const Event &e = c->events[i];
+                    fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", e.name, b->id,
+                            (e.begin - origin()) / 1000.0, (e.end - e.begin) / 1000.0);
+                }
+            }
+        }
+        fprintf(file, "\n]}\n");
+        return fclose(file) == 0;
+    }
+
+    // for spans that aren't a C++ scope: take now() at the start and record at the end,
+    // only while enabled(). The name has to outlive the program (a string literal)
+    static uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    static void record(const char *name, uint64_t begin, uint64_t end)
+    {
+        Buffer &b = local();
+        uint32_t count = b.last->count.load(std::memory_order_relaxed);
+        if (count == CHUNK_EVENTS)
+        {
+            Chunk *chunk = new Chunk;
+            b.last->next.store(chunk, std::memory_order_release);
+            b.last = chunk;
+            count = 0;
+        }
+        b.last->events[count] = {name, begin, end};
+        b.last->count.store(count + 1, std::memory_order_release);
+    }
+
+    // records the time between construction and destruction, name has to be a string literal
+    class Scope
+    {
+    public:
+        explicit Scope(const char *eventName) : name(enabled() ? eventName : nullptr), begin(name ? now() : 0)
+        {
+        }
+        ~Scope()
+        {
+            if (name)
+                record(name, begin, now());
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *name;
+        uint64_t begin;
+    };
+
+private:
+    struct Event
+    {
+        const char *name;
+        uint64_t begin, end; // nanoseconds
+    };
+    struct Chunk
+    {
+        std::atomic<uint32_t> count{0};
+        std::atomic<Chunk *> next{nullptr};
+        Event events[CHUNK_EVENTS];
+    };
+    struct Buffer
+    {
+        uint32_t id = 0;
+        const char *name = nullptr;
+        Buffer *next = nullptr;
+        Buffer *nextFree = nullptr; // in the pool, guarded by poolMutex
+        Chunk first;
+        Chunk *last = &first; // only touched by the owning thread
+    };
+
+    static std::atomic<bool> &flag()
+    {
+        static std::atomic<bool> on{false};
+        return on;
+    }
+    static uint64_t &origin()
+    {
+        static uint64_t time = 0;
+        return time;
+    }
+    static std::atomic<Buffer *> &head()
+    {
+        static std::atomic<Buffer *> list{nullptr};
+        return list;
+    }
+    static std::mutex &poolMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+    // buffers of threads that exited, their events stay for write
+    static Buffer *&pool()
+    {
+        static Buffer *free = nullptr;
+        return free;
+    }
+    // hands the thread's buffer back to the pool when the thread exits
+    struct Owner
+    {
+        Buffer *buffer = nullptr;
+        ~Owner()
+        {
+            if (!buffer)
+                return;
+            std::lock_guard<std::mutex> lock(poolMutex());
+            buffer->nextFree = pool();
+            pool() = buffer;
+        }
+    };
+    // the calling thread's buffer, taken from the pool or allocated on its first event.
+    // Buffers are never freed, so events of threads that already finished can be written.
+    static Buffer &local()
+    {
+        thread_local Owner owner;
+        if (!owner.buffer)
+        {
+            {
+                std::lock_guard<std::mutex> lock(poolMutex());
+                owner.buffer = pool();
+                if (owner.buffer)
+                    pool() = owner.buffer->nextFree;
+            }
+            if (owner.buffer)
+                return *owner.buffer;
+            static std::atomic<uint32_t> nextId{1};
+            Buffer *buffer = new Buffer;
+            buffer->id = nextId.fetch_add(1, std::memory_order_relaxed);
+            Buffer *old = head().load(std::memory_order_relaxed);
+            do
+                buffer->next = old;
+            while (!head().compare_exchange_weak(old, buffer, std::memory_order_release, std::memory_order_relaxed));
+            owner.buffer = buffer;
+        }
+        return *owner.buffer;
+    }
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// times the rest of the enclosing block as one trace event
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif
@@ -0,0 +1,89 @@
+// Writes a C++ source file holding the given files as constant byte arrays, with the
+// EMBEDDED_ASSETS table declared in EmbeddedAssets.h. Usage: EmbedAssets output.cpp file...
+//
+// The bytes are written as string literals rather than comma separated numbers, which
+// compilers parse many times faster for multi-megabyte files. The file paths are stored as
+// given, so they match the relative paths the game loads.
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// bytes per string literal line
+const size_t LINE_BYTES = 64;
+
+// writes the file as array asset<index>, returns its size or -1 if it can't be read
+long long embed(ostream &out, int index, const char *path)
+{
+    ifstream file(path, ios::binary);
+    if (!file)
+    {
+        cerr << "Unable to read " << path << endl;
+        return -1;
+    }
+    vector<unsigned char> bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    // the literal's terminating zero is one more byte than the file, the size excludes it
+    // aligned so formats with an index of structs (an asset pack) can be used in place
+    out << "alignas(16) static const unsigned char asset" << index << "[" << bytes.size() + 1 << "] =";
+    if (bytes.empty())
+        out << " \"\"";
+    for (size_t i = 0; i < bytes.size(); i++)
+    {
+        if (i % LINE_BYTES == 0)
+            out << (i ? "\"\n    \"" : "\n    \"");
+        // octal escapes are at most three digits, so a following digit can't run into them
+        unsigned char c = bytes[i];
+        out << '\\' << char('0' + (c >> 6)) << char('0' + ((c >> 3) & 7)) << char('0' + (c & 7));
+    }
+    if (!bytes.empty())
+        out << "\"";
+    out << ";\n";
+    return static_cast<long long>(bytes.size());
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        cerr << "Usage: EmbedAssets output.cpp file..." << endl;
+        return 1;
+    }
+    ofstream out(argv[1], ios::binary);
+    if (!out)
+    {
+        cerr << "Unable to write " << argv[1] << endl;
+        return 1;
+    }
+    out << "// generated by tools/EmbedAssets, do not edit\n#include \"EmbeddedAssets.h\"\n\n";
+    int count = argc - 2;
+    vector<long long> sizes;
+    for (int i = 0; i < count; i++)
+    {
+        sizes.push_back(embed(out, i, argv[i + 2]));
+        if (sizes.back() < 0)
+            return 1;
+    }
+    out << "\nconst EmbeddedAsset EMBEDDED_ASSETS[] = {\n";
+    for (int i = 0; i < count; i++)
+    {
+        // backslashes of Windows paths would start escapes
+        string path = argv[i + 2];
+        for (char &c : path)
+        {
+            if (c == '\\')
+                c = '/';
+        }
+        out << "    {\"" << path << "\", asset" << i << ", " << sizes[i] << "},\n";
+    }
+    out << "};\nconst int EMBEDDED_ASSET_COUNT = " << count << ";\n";
+    if (!out.flush())
+    {
+        cerr << "Unable to write " << argv[1] << endl;
+        return 1;
+    }
+    cout << "Embedded " << count << " files into " << argv[1] << endl;
+    return 0;
+}
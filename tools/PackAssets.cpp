@@ -0,0 +1,131 @@
+// Builds an asset pack (see AssetPack.h) from BMP files. Usage: PackAssets output.pack file...
+//
+// Every image is decoded here once and converted to ARGB8888 if it isn't already (24 bit or
+// palette BMPs), so the game only has to decompress its pixels and upload them. The time
+// converting takes is printed, it's what every startup would spend on it otherwise. Paths
+// are stored as given, so they match the relative paths the game loads.
+#include <SDL2/SDL.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../AssetPack.h"
+
+using namespace std;
+
+struct PackedImage
+{
+    string path;
+    AssetPack::Entry entry;
+    vector<uint8_t> blob;
+};
+
+// images converted to the pack's pixel format and the time it took
+int convertedImages = 0;
+double convertMs = 0;
+
+// decodes, converts and compresses one image, false if it can't be loaded
+bool packImage(const char *path, PackedImage &image)
+{
+    SDL_Surface *surface = SDL_LoadBMP(path);
+    if (!surface)
+    {
+        cerr << "Unable to load image: " << path << "! SDL_Error: " << SDL_GetError() << endl;
+        return false;
+    }
+    if (surface->format->format != AssetPack::PIXEL_FORMAT)
+    {
+        Uint64 start = SDL_GetPerformanceCounter();
+        SDL_Surface *converted = SDL_ConvertSurfaceFormat(surface, AssetPack::PIXEL_FORMAT, 0);
+        convertMs += (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+        convertedImages++;
+        SDL_FreeSurface(surface);
+        if (!converted)
+        {
+            cerr << "Unable to convert image: " << path << "! SDL_Error: " << SDL_GetError() << endl;
+            return false;
+        }
+        surface = converted;
+    }
+    size_t size = static_cast<size_t>(surface->pitch) * surface->h;
+    image.path = path;
+    for (char &c : image.path)
+    {
+        if (c == '\\')
+            c = '/';
+    }
+    image.blob.resize(LZ4Block::bound(size));
+    size_t compressed = LZ4Block::compress(static_cast<const uint8_t *>(surface->pixels), size, image.blob.data(), image.blob.size());
+    image.blob.resize(compressed);
+    image.entry = {};
+    image.entry.compressedSize = static_cast<uint32_t>(compressed);
+    image.entry.width = surface->w;
+    image.entry.height = surface->h;
+    image.entry.pitch = surface->pitch;
+    image.entry.format = surface->format->format;
+    // check the round trip before anything is written
+    vector<uint8_t> check(size);
+    bool same = LZ4Block::decompress(image.blob.data(), compressed, check.data(), size) && memcmp(check.data(), surface->pixels, size) == 0;
+    SDL_FreeSurface(surface);
+    if (!same)
+    {
+        cerr << "Compressing " << path << " doesn't round trip" << endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        cerr << "Usage: PackAssets output.pack file..." << endl;
+        return 1;
+    }
+    int count = argc - 2;
+    vector<PackedImage> images(count);
+    size_t rawSize = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (!packImage(argv[i + 2], images[i]))
+            return 1;
+        rawSize += static_cast<size_t>(images[i].entry.pitch) * images[i].entry.height;
+    }
+
+    // header and index first, then the paths, then the blobs each aligned to 16 bytes
+    uint64_t offset = sizeof(AssetPack::Header) + count * sizeof(AssetPack::Entry);
+    for (PackedImage &image : images)
+    {
+        image.entry.pathOffset = static_cast<uint32_t>(offset);
+        image.entry.pathLength = static_cast<uint32_t>(image.path.size());
+        offset += image.path.size();
+    }
+    for (PackedImage &image : images)
+    {
+        offset = (offset + 15) & ~uint64_t(15);
+        image.entry.dataOffset = offset;
+        offset += image.blob.size();
+    }
+    vector<uint8_t> pack(offset, 0);
+    AssetPack::Header header = {AssetPack::MAGIC, AssetPack::VERSION, static_cast<uint32_t>(count), 0};
+    memcpy(pack.data(), &header, sizeof(header));
+    for (int i = 0; i < count; i++)
+    {
+        const PackedImage &image = images[i];
+        memcpy(pack.data() + sizeof(header) + i * sizeof(AssetPack::Entry), &image.entry, sizeof(image.entry));
+        memcpy(pack.data() + image.entry.pathOffset, image.path.data(), image.path.size());
+        memcpy(pack.data() + image.entry.dataOffset, image.blob.data(), image.blob.size());
+    }
+
+    ofstream out(argv[1], ios::binary);
+    if (!out.write(reinterpret_cast<const char *>(pack.data()), pack.size()))
+    {
+        cerr << "Unable to write " << argv[1] << endl;
+        return 1;
+    }
+    cout << "Packed " << count << " images into " << argv[1] << ": " << pack.size() << " bytes, " << rawSize << " bytes of pixels ("
+         << 100.0 * pack.size() / rawSize << "%)" << endl;
+    cout << "Converted " << convertedImages << " of " << count << " images to " << SDL_GetPixelFormatName(AssetPack::PIXEL_FORMAT)
+         << " in " << convertMs << " ms, the game loads them without converting" << endl;
+    return 0;
+}
@@ -0,0 +1,220 @@
+// Checks the game tree search of GameRules.h against results known by hand, and every
+// position of PositionTable against Solver run on that position alone, for several thread
+// counts of both the table build and evaluateBatch, and the packed states of
+// PackedState.h against the GridState they stand for. Exits with 1 if anything differs.
+// Usage: SolverCheck
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "../GameRules.h"
+#include "../PositionTable.h"
+#include "../PackedState.h"
+
+using namespace std;
+
+// position from its cells row by row ('-', 'o' or 'x'), o moves first so the counts give the mover
+template <int N>
+GridState<N> parse(const char *cells)
+{
+    GridState<N> s;
+    int os = 0, xs = 0;
+    for (int i = 0; i < N * N; i++)
+    {
+        s.cells[i] = cells[i];
+        os += cells[i] == 'o';
+        xs += cells[i] == 'x';
+    }
+    s.moves = os + xs;
+    s.player = os > xs ? 'x' : 'o';
+    return s;
+}
+
+const char *resultName(int score)
+{
+    return score > 0 ? "mover wins" : (score < 0 ? "mover loses" : "draw");
+}
+
+// solves the position and compares the sign of its score, and the best move if one is expected
+template <class Rules>
+bool check(const char *name, const char *cells, int expected, int expectedMove = -1)
+{
+    Solver<Rules> solver;
+    int move = -1;
+    int score = solver.solve(parse<Rules::SIZE>(cells), &move);
+    int sign = score > 0 ? 1 : (score < 0 ? -1 : 0);
+    bool ok = sign == expected && (expectedMove < 0 || move == expectedMove);
+    cout << (ok ? "ok     " : "FAILED ") << name << ": " << resultName(score) << " (score " << score << ", move " << move
+         << ", " << solver.nodeCount() << " nodes)";
+    if (!ok)
+        cout << ", expected " << resultName(expected) << (expectedMove >= 0 ? " with move " + to_string(expectedMove) : "");
+    cout << endl;
+    return ok;
+}
+
+// the outcome a solver score stands for, scores are from the side to move
+Outcome scoreOutcome(int score, char mover)
+{
+    if (score == 0)
+        return OUTCOME_DRAW;
+    return (score > 0) == (mover == 'o') ? OUTCOME_O_WINS : OUTCOME_X_WINS;
+}
+
+// builds the table with each thread count and looks every position up through
+// evaluateBatch with each thread count. Outcomes have to match Solver, best moves have to
+// be legal and keep the outcome, and both have to be the same whatever the thread counts.
+template <class Rules>
+bool checkTable(const char *name)
+{
+    typedef typename Rules::State State;
+    const int THREADS[] = {1, 2, 4, 8};
+    // big enough that evaluateBatch splits it across every thread count above
+    const size_t BATCH = 1 << 18;
+
+    PositionTable<Rules> reference(1);
+    const PositionIndex<Rules::SIZE> &index = reference.positionIndex();
+    uint64_t count = reference.size();
+    vector<Outcome> expected(count);
+    Solver<Rules> solver;
+    for (uint64_t r = 0; r < count; r++)
+    {
+        State s = index.unrank(r);
+        Outcome result = Rules::outcome(s);
+        expected[r] = result != OUTCOME_ONGOING ? result : scoreOutcome(solver.solve(s), s.player);
+    }
+    // every position, repeated until the batch is full
+    vector<uint32_t> positions(BATCH);
+    for (size_t i = 0; i < BATCH; i++)
+        positions[i] = static_cast<uint32_t>(i % count);
+    vector<Outcome> outcomes(BATCH), firstOutcomes;
+    vector<int8_t> moves(BATCH), firstMoves;
+
+    long long mismatches = 0;
+    for (int buildThreads : {1, 4})
+    {
+        PositionTable<Rules> table(buildThreads);
+        for (int threads : THREADS)
+        {
+            table.evaluateBatch(positions.data(), BATCH, outcomes.data(), moves.data(), threads);
+            if (firstOutcomes.empty())
+            {
+                firstOutcomes = outcomes;
+                firstMoves = moves;
+            }
+            for (size_t i = 0; i < BATCH; i++)
+            {
+                uint32_t r = positions[i];
+                bool ok = outcomes[i] == expected[r] && outcomes[i] == firstOutcomes[i] && moves[i] == firstMoves[i];
+                if (ok && Rules::outcome(index.unrank(r)) == OUTCOME_ONGOING)
+                {
+                    // the best move has to be one of the moves and lead to the same outcome
+                    State s = index.unrank(r);
+                    typename Rules::Move legal[Rules::MAX_MOVES];
+                    int legalCount = Rules::generateMoves(s, legal);
+                    ok = false;
+                    for (int m = 0; m < legalCount; m++)
+                        ok = ok || legal[m] == moves[i];
+                    if (ok)
+                    {
+                        Rules::makeMove(s, moves[i]);
+                        ok = expected[table.encode(s)] == expected[r];
+                    }
+                }
+                mismatches += !ok;
+            }
+        }
+    }
+    bool ok = mismatches == 0;
+    cout << (ok ? "ok     " : "FAILED ") << name << ": " << count << " positions, " << BATCH << " lookups per thread count";
+    if (!ok)
+        cout << ", " << mismatches << " mismatches";
+    cout << endl;
+    return ok;
+}
+
+bool sameState(const GridState<3> &a, const GridState<3> &b)
+{
+    return memcmp(a.cells, b.cells, sizeof(a.cells)) == 0 && a.player == b.player && a.moves == b.moves;
+}
+
+// plays random games on a GridState and its packed form side by side. After every move
+// the packed state has to convert back to the same position, and agree on every cell, the
+// side to move and the outcome. Moves onto taken cells have to be refused.
+template <class Rules, class Packed>
+bool checkPacked(const char *name, int games)
+{
+    typedef typename Rules::State State;
+    // a fixed linear congruential generator, so failures repeat
+    uint32_t seed = 12345;
+    auto random = [&seed](int range)
+    {
+        seed = seed * 1103515245u + 12345u;
+        return static_cast<int>((seed >> 16) % range);
+    };
+    long long positions = 0, mismatches = 0;
+    for (int g = 0; g < games; g++)
+    {
+        State s;
+        Packed p = Packed::pack(s);
+        while (true)
+        {
+            positions++;
+            GridState<Rules::SIZE> back = p.toState();
+            bool ok = p.player() == s.player && p.outcome() == Rules::outcome(s) && back.player == s.player && back.moves == s.moves;
+            for (int i = 0; i < Rules::CELLS; i++)
+                ok = ok && p.cell(i) == s.cells[i] && back.cells[i] == s.cells[i];
+            mismatches += !ok;
+            if (Rules::isTerminal(s))
+                break;
+            typename Rules::Move moves[Rules::MAX_MOVES];
+            int count = Rules::generateMoves(s, moves);
+            int move = moves[random(count)];
+            Rules::makeMove(s, move);
+            mismatches += !p.makeMove(move) || p.makeMove(move);
+        }
+    }
+    bool ok = mismatches == 0;
+    cout << (ok ? "ok     " : "FAILED ") << name << ": " << games << " random games, " << positions << " positions";
+    if (!ok)
+        cout << ", " << mismatches << " mismatches";
+    cout << endl;
+    return ok;
+}
+
+// packs rows of chars like ReferenceBoard::board and unpacks them again
+bool checkPackedBoard()
+{
+    char board[3][3] = {{'o', 'x', '-'}, {'-', 'o', '-'}, {'x', '-', '-'}};
+    char unpacked[3][3], player;
+    PackedState packed = PackedState::pack(board, 'o');
+    packed.unpack(unpacked, player);
+    bool ok = memcmp(board, unpacked, sizeof(board)) == 0 && player == 'o' && sameState(packed.toState(), parse<3>("ox--o-x--"));
+    cout << (ok ? "ok     " : "FAILED ") << "packed board round trip" << endl;
+    return ok;
+}
+
+int main()
+{
+    int failures = 0;
+    // perfect play draws both tic tac toe and its misere version
+    failures += !check<ClassicRules<3, 3>>("classic 3x3 from empty", "---------", 0);
+    failures += !check<MisereRules<3, 3>>("misere 3x3 from empty", "---------", 0);
+    // o has to take the last cell and complete its own row
+    failures += !check<MisereRules<3, 3>>("misere forced line", "oo-xxoxox", -1, 2);
+    // o drops into the right column, lands at the bottom and completes that row
+    failures += !check<GravityRules<3, 3>>("gravity drop to win", "---xx-oo-", 1, 8);
+    // both threaten a column, o moves first and completes its own
+    failures += !check<ClassicRules<3, 3>>("classic win in one", "ox-ox----", 1, 6);
+    failures += !checkTable<ClassicRules<3, 3>>("classic 3x3 table");
+    failures += !checkTable<MisereRules<3, 3>>("misere 3x3 table");
+    failures += !checkTable<GravityRules<3, 3>>("gravity 3x3 table");
+    failures += !checkPacked<ClassicRules<3, 3>, PackedState>("packed 3x3 state", 10000);
+    failures += !checkPacked<ClassicRules<3, 3>, PackedGrid<3, 3>>("packed 3x3 grid", 10000);
+    failures += !checkPacked<ClassicRules<4, 4>, PackedGrid<4, 4>>("packed 4x4 grid", 10000);
+    failures += !checkPacked<ClassicRules<5, 4>, PackedGrid<5, 4>>("packed 5x5 grid", 10000);
+    failures += !checkPackedBoard();
+    if (failures)
+        cout << failures << " checks failed" << endl;
+    else
+        cout << "All checks passed" << endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+// Enumerates the complete game tree of K-in-a-row on an NxN board and prints per-move
+// statistics. Usage: TreeStats [size] [k] [threads]
+//
+// Instead of walking every path of the tree, the number of paths reaching each position is
+// pushed forward one move at a time through flat arrays indexed by PositionIndex rank, so
+// positions shared by many games are visited once while tree totals stay exact.
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "../GameRules.h"
+#include "../PositionIndex.h"
+
+using namespace std;
+
+struct PlyStats
+{
+    uint64_t nodes = 0, children = 0, expanded = 0;
+    uint64_t oWins = 0, xWins = 0, draws = 0;                   // games ending at this move
+    uint64_t unique = 0, uniqueSymmetric = 0, uniqueTerminal = 0; // distinct positions
+
+    void add(const PlyStats &other)
+    {
+        nodes += other.nodes;
+        children += other.children;
+        expanded += other.expanded;
+        oWins += other.oWins;
+        xWins += other.xWins;
+        draws += other.draws;
+        unique += other.unique;
+        uniqueSymmetric += other.uniqueSymmetric;
+        uniqueTerminal += other.uniqueTerminal;
+    }
+};
+
+template <class Rules>
+int enumerate(int threads)
+{
+    typedef typename Rules::State State;
+    const int CELLS = Rules::CELLS;
+
+    auto start = chrono::steady_clock::now();
+    PositionIndex<Rules::SIZE> index;
+    // number of distinct move sequences reaching each position
+    vector<atomic<uint64_t>> paths(index.size());
+    paths[0] = 1;
+
+    vector<PlyStats> plies(CELLS + 1);
+    for (int ply = 0; ply <= CELLS; ply++)
+    {
+        uint64_t begin = index.layerBegin(ply), end = index.layerBegin(ply + 1);
+        vector<PlyStats> partial(threads);
+        vector<thread> workers;
+        uint64_t chunk = (end - begin + threads - 1) / threads;
+        for (int t = 0; t < threads; t++)
+        {
+            uint64_t from = begin + t * chunk, to = min(end, from + chunk);
+            workers.emplace_back([&, t, from, to]()
+                                 {
+                                     PlyStats &stats = partial[t];
+                                     typename Rules::Move moves[Rules::MAX_MOVES];
+                                     for (uint64_t r = from; r < to; r++)
+                                     {
+                                         uint64_t count = paths[r].load(memory_order_relaxed);
+                                         if (count == 0)
+                                             continue;
+                                         State s = index.unrank(r);
+                                         stats.nodes += count;
+                                         stats.unique++;
+                                         if (index.rank(Rules::canonical(s)) == r)
+                                             stats.uniqueSymmetric++;
+
+                                         Outcome result = Rules::outcome(s);
+                                         if (result != OUTCOME_ONGOING)
+                                         {
+                                             stats.uniqueTerminal++;
+                                             if (result == OUTCOME_O_WINS)
+                                                 stats.oWins += count;
+                                             else if (result == OUTCOME_X_WINS)
+                                                 stats.xWins += count;
+                                             else
+                                                 stats.draws += count;
+                                             continue;
+                                         }
+                                         int moveCount = Rules::generateMoves(s, moves);
+                                         stats.expanded += count;
+                                         stats.children += count * moveCount;
+                                         for (int i = 0; i < moveCount; i++)
+                                         {
+                                             Rules::makeMove(s, moves[i]);
+                                             paths[index.rank(s)].fetch_add(count, memory_order_relaxed);
+                                             Rules::unmakeMove(s, moves[i]);
+                                         }
+                                     }
+                                 });
+        }
+        for (auto &worker : workers)
+            worker.join();
+        for (auto &stats : partial)
+            plies[ply].add(stats);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    PlyStats total;
+    cout << setw(4) << "ply" << setw(16) << "nodes" << setw(14) << "o wins" << setw(14) << "x wins"
+         << setw(14) << "draws" << setw(10) << "branch" << setw(12) << "unique" << setw(10) << "symmetric"
+         << setw(10) << "terminal" << endl;
+    for (int ply = 0; ply <= CELLS; ply++)
+    {
+        const PlyStats &p = plies[ply];
+        total.add(p);
+        double branching = p.expanded ? double(p.children) / p.expanded : 0.0;
+        cout << setw(4) << ply << setw(16) << p.nodes << setw(14) << p.oWins << setw(14) << p.xWins
+             << setw(14) << p.draws << setw(10) << fixed << setprecision(2) << branching << setw(12) << p.unique
+             << setw(10) << p.uniqueSymmetric << setw(10) << p.uniqueTerminal << endl;
+    }
+    cout << "games: " << total.oWins + total.xWins + total.draws << " (o " << total.oWins << ", x " << total.xWins
+         << ", draw " << total.draws << ")" << endl;
+    cout << "tree nodes: " << total.nodes << ", unique positions: " << total.unique
+         << ", after symmetry: " << total.uniqueSymmetric << ", terminal: " << total.uniqueTerminal << endl;
+    cout << "time: " << setprecision(3) << seconds << " s, " << setprecision(0) << total.unique / seconds
+         << " positions/s, table memory: " << index.size() * sizeof(uint64_t) / 1024 << " KiB" << endl;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int size = argc > 1 ? atoi(argv[1]) : 3;
+    int k = argc > 2 ? atoi(argv[2]) : size;
+    int threads = argc > 3 ? atoi(argv[3]) : static_cast<int>(thread::hardware_concurrency());
+    if (threads < 1)
+        threads = 1;
+
+    if (size == 3 && k == 3)
+        return enumerate<ClassicRules<3, 3>>(threads);
+    if (size == 4 && k == 3)
+        return enumerate<ClassicRules<4, 3>>(threads);
+    if (size == 4 && k == 4)
+        return enumerate<ClassicRules<4, 4>>(threads);
+    cerr << "Unsupported board: " << size << "x" << size << " with " << k << " in a row (use 3 3, 4 3 or 4 4)" << endl;
+    return 1;
+}